@@ -32,3 +32,43 @@ terminalio.c
 
 timer0.c
 
+replay.c
+
+zobrist.c
+
+transposition.c
+
+bitboard.c
+
+controller.c
+
+autopilot.c
+
+hamiltonian.c
+
+mcts.c
+
+tournament.c
+
+neural.c
+
+exporter.c
+
+benchmark.c
+
+tickstats.c
+
+trace.c
+
+memory.c
+
+telemetry.c
+
+frame.c
+
+botlink.c
+
+input.c
+
+latency.c
+
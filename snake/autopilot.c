@@ -0,0 +1,226 @@
+/*
+ * autopilot.c
+ *
+ * Written by Hans Song
+ */
+
+#include "autopilot.h"
+#include "bitboard.h"
+#include "snake.h"
+#include "food.h"
+#include "rat.h"
+#include "superfood.h"
+
+/* Longest path we will plan. Planning keeps one bitboard (16 bytes) per
+ * step on the stack. Items further away than this are still headed
+ * towards, one step at a time, by replanning each move.
+ */
+#define AUTOPILOT_MAX_PATH 16
+
+/* The planned path (cells to move to, in order), the index of the next
+ * cell to move to and the items that were on the board when we planned.
+ */
+static PosnType path[AUTOPILOT_MAX_PATH];
+static uint8_t path_length;
+static uint8_t path_index;
+static Bitboard planned_targets;
+
+void init_autopilot(void) {
+	path_length = 0;
+	path_index = 0;
+}
+
+/* Set targets to the cells holding items the snake can eat */
+static void get_target_bitboard(Bitboard targets) {
+	bitboard_clear(targets);
+	for(int8_t i = 0; i < get_num_food_items(); i++) {
+		bitboard_set(targets, get_position_of_food(i));
+	}
+	if(get_super_food_existence()) {
+		bitboard_set(targets, get_super_food_pos());
+	}
+	bitboard_set(targets, get_rat_pos());
+}
+
+/* Return the direction from posn to the adjacent cell next, or -1 if
+ * the cells are not adjacent.
+ */
+static int8_t direction_to(PosnType posn, PosnType next) {
+	for(uint8_t dirn = SNAKE_UP; dirn <= SNAKE_LEFT; dirn++) {
+		if(next_position(posn, dirn) == next) {
+			return dirn;
+		}
+	}
+	return -1;
+}
+
+/* Return the first cell of a bitboard (which must not be empty) */
+static PosnType first_cell(const Bitboard board) {
+	for(uint8_t y = 0; y < BOARD_HEIGHT; y++) {
+		if(board[y]) {
+			uint8_t x = 0;
+			while(!(board[y] & (1 << x))) {
+				x++;
+			}
+			return position(x, y);
+		}
+	}
+	return INVALID_POSITION;
+}
+
+/* Breadth first search from the head, one layer at a time, until we reach
+ * a target. Then work back through the layers to find the path to it.
+ */
+static void plan_path(const Bitboard blocked, const Bitboard targets,
+		PosnType head) {
+	Bitboard layers[AUTOPILOT_MAX_PATH];
+	Bitboard visited, frontier, reached;
+	uint8_t layer, y;
+	int8_t step;
+	
+	path_length = 0;
+	path_index = 0;
+	bitboard_clear(visited);
+	bitboard_clear(frontier);
+	bitboard_set(visited, head);
+	bitboard_set(frontier, head);
+	
+	for(layer = 0; layer < AUTOPILOT_MAX_PATH; layer++) {
+		if(!bitboard_bfs_layer(blocked, visited, frontier)) {
+			/* Nothing can be reached */
+			return;
+		}
+		bitboard_copy(frontier, layers[layer]);
+		uint16_t any = 0;
+		for(y = 0; y < BOARD_HEIGHT; y++) {
+			reached[y] = frontier[y] & targets[y];
+			any |= reached[y];
+		}
+		if(any) {
+			break;
+		}
+	}
+	if(layer == AUTOPILOT_MAX_PATH) {
+		/* Too far away to plan */
+		return;
+	}
+	
+	/* Work back from the target - each step of the path is a neighbour
+	 * of the next step that was reached in the layer before.
+	 */
+	path[layer] = first_cell(reached);
+	for(step = layer - 1; step >= 0; step--) {
+		for(uint8_t dirn = SNAKE_UP; dirn <= SNAKE_LEFT; dirn++) {
+			PosnType cell = next_position(path[step + 1], dirn);
+			if(bitboard_test(layers[step], cell)) {
+				path[step] = cell;
+				break;
+			}
+		}
+	}
+	path_length = layer + 1;
+	bitboard_copy(targets, planned_targets);
+}
+
+/* Check that once the snake has followed the planned path (and grown by
+ * one on eating at the end of it) it can still reach its own tail - so it
+ * can't have trapped itself.
+ */
+static uint8_t path_is_safe(void) {
+	Bitboard body, tail;
+	uint8_t length = get_snake_length();
+	uint8_t i;
+	PosnType new_tail;
+	
+	/* The tail advances one less time than the head moves, since we grow
+	 * at the end of the path. The rest of the old body and the path make
+	 * up the new body.
+	 */
+	bitboard_clear(body);
+	for(i = path_length - 1; i < length; i++) {
+		bitboard_set(body, get_snake_position(i));
+	}
+	for(i = 0; i < path_length; i++) {
+		bitboard_set(body, path[i]);
+	}
+	if(path_length - 1 < length) {
+		new_tail = get_snake_position(path_length - 1);
+	} else {
+		new_tail = path[path_length - 1 - length];
+	}
+	bitboard_reset(body, new_tail);
+	bitboard_clear(tail);
+	bitboard_set(tail, new_tail);
+	return bitboard_distance(body, path[path_length - 1], tail) != UNREACHABLE;
+}
+
+/* Return the direction which leads to the largest region of free cells,
+ * or the current direction if we are boxed in.
+ */
+static SnakeDirnType survival_dirn(const Bitboard blocked, PosnType head) {
+	Bitboard region;
+	SnakeDirnType best_dirn = get_snake_dirn();
+	uint8_t best_size = 0;
+	for(uint8_t dirn = SNAKE_UP; dirn <= SNAKE_LEFT; dirn++) {
+		PosnType cell = next_position(head, dirn);
+		if(!bitboard_test(blocked, cell)) {
+			uint8_t size = bitboard_flood_fill(blocked, cell, region);
+			if(size > best_size) {
+				best_size = size;
+				best_dirn = dirn;
+			}
+		}
+	}
+	return best_dirn;
+}
+
+SnakeDirnType autopilot_dirn(void) {
+	Bitboard blocked, targets, region;
+	PosnType head = get_snake_head_position();
+	uint8_t y, targets_changed = 0;
+	
+	/* The tail moves out of the way as we move so it doesn't block us,
+	 * but we can't reverse (into the cell behind the head).
+	 */
+	get_snake_bitboard(blocked);
+	bitboard_reset(blocked, get_snake_tail_position());
+	bitboard_set(blocked, next_position(head, (get_snake_dirn() + 2) % 4));
+	get_target_bitboard(targets);
+	
+	for(y = 0; y < BOARD_HEIGHT; y++) {
+		if(targets[y] != planned_targets[y]) {
+			targets_changed = 1;
+		}
+	}
+	
+	/* Plan a new path unless the old one is still good. The cells on a
+	 * path can only become blocked by the head moving along the path (the
+	 * rest of the snake only moves out of the way), but we check anyway.
+	 */
+	if(targets_changed || path_index >= path_length ||
+			bitboard_test(blocked, path[path_index]) ||
+			direction_to(head, path[path_index]) < 0) {
+		plan_path(blocked, targets, head);
+		
+		/* Only follow the new path if we won't be trapped at the end */
+		if(path_length > 0 && !path_is_safe()) {
+			path_length = 0;
+		}
+		
+		/* If there's no safe way to an item, follow our tail - the
+		 * space it leaves behind is always free. We plan a single step
+		 * at a time since the tail moves each time we do.
+		 */
+		if(path_length == 0) {
+			bitboard_clear(region);
+			bitboard_set(region, get_snake_tail_position());
+			plan_path(blocked, region, head);
+			path_length = (path_length > 0);
+		}
+	}
+	
+	if(path_index < path_length) {
+		return direction_to(head, path[path_index++]);
+	}
+	return survival_dirn(blocked, head);
+}
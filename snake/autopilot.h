@@ -0,0 +1,29 @@
+/*
+ * autopilot.h
+ *
+ * Written by Hans Song
+ *
+ * Autopilot controller. Steers the snake along a shortest path to the
+ * nearest item it can eat (food, super food or the rat), taking the
+ * wrap-around at the edges of the board into account. The path is kept
+ * and followed on later moves for as long as it stays valid - i.e. the
+ * items on the board haven't changed and the next cell is still free -
+ * so a search is only needed when something changes. Before a new path
+ * is followed we check the snake could still reach its own tail from the
+ * end of it (so it can't trap itself); if not (or if nothing can be
+ * reached) the autopilot follows its own tail or, failing that, heads
+ * for the largest open space.
+ */
+
+#ifndef AUTOPILOT_H_
+#define AUTOPILOT_H_
+
+#include "snake.h"
+
+/* Forget any planned path. Must be called at the start of each game. */
+void init_autopilot(void);
+
+/* Return the direction the snake should move in next. */
+SnakeDirnType autopilot_dirn(void);
+
+#endif /* AUTOPILOT_H_ */
@@ -0,0 +1,354 @@
+/*
+ * benchmark.c
+ *
+ * Written by Hans Song
+ */
+
+#include <stdio.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#include "benchmark.h"
+#include "autopilot.h"
+#include "bitboard.h"
+#include "board.h"
+#include "food.h"
+#include "game.h"
+#include "hamiltonian.h"
+#include "ledmatrix.h"
+#include "rat.h"
+#include "score.h"
+#include "scrolling_char_display.h"
+#include "serialio.h"
+#include "snake.h"
+#include "telemetry.h"
+#include "terminalio.h"
+#include "zobrist.h"
+
+#define BENCHMARK_REPS 16
+
+/* All benchmarks start from the same game so results can be compared */
+#define BENCHMARK_SEED 1
+
+/* Snake lengths to benchmark at */
+static const uint8_t benchmark_lengths[] PROGMEM = {2, 16, MAX_SNAKE_SIZE};
+
+static uint16_t samples[BENCHMARK_REPS];
+static uint16_t other_samples[BENCHMARK_REPS];
+
+/* Cycles taken by the timing itself, subtracted from every sample */
+static uint16_t overhead;
+
+/* Sample recorded for a statement that took 65536 cycles or more (so
+ * timer 1 overflowed)
+ */
+#define OVERFLOWED UINT16_MAX
+
+/* Time a statement in CPU cycles, storing the result in sample. Timer 1
+ * is started from 0 so an overflow means the statement took too long to
+ * time. The UART is emptied first: with interrupts off nothing is sent,
+ * so anything the statement prints has to fit in the output buffer or it
+ * would be lost.
+ */
+#define TIME(statement, sample) do {\
+		uint8_t overflowed;\
+		while(!serial_output_empty()) {\
+			;\
+		}\
+		cli();\
+		TCNT1 = 0;\
+		TIFR1 = (1<<TOV1);\
+		statement;\
+		(sample) = TCNT1;\
+		overflowed = TIFR1 & (1<<TOV1);\
+		sei();\
+		(sample) = overflowed ? OVERFLOWED : (sample) - overhead;\
+	} while(0)
+
+/* Sort the first n samples of a set and write out a line for them, and
+ * another if any of them overflowed.
+ */
+static void report(PGM_P name, uint16_t* set, uint8_t n) {
+	uint8_t i, j, overflows = 0;
+	uint16_t value;
+	
+	if(n == 0) {
+		return;
+	}
+	for(i = 1; i < n; i++) {
+		value = set[i];
+		for(j = i; j > 0 && set[j - 1] > value; j--) {
+			set[j] = set[j - 1];
+		}
+		set[j] = value;
+	}
+	printf_P(PSTR("B,%S,%u,%u,%u,%u,%u\n"), name, get_snake_length(), n,
+			set[0], set[n / 2], set[n - 1]);
+	for(i = 0; i < n; i++) {
+		overflows += (set[i] == OVERFLOWED);
+	}
+	if(overflows) {
+		printf_P(PSTR("%S overflowed the timer in %u of %u samples at length %u\n"),
+				name, overflows, n, get_snake_length());
+	}
+}
+
+/* Start the benchmark game and let the autopilot play until the snake
+ * is the given length.
+ */
+static void setup_game(uint8_t length) {
+	set_game_seed(BENCHMARK_SEED);
+	init_game();
+	init_score();
+	init_move_delay();
+	init_autopilot();
+	for(uint16_t moves = 0; moves < 1000 && get_snake_length() < length; moves++) {
+		set_snake_dirn(autopilot_dirn());
+		if(!attempt_to_move_snake_forward()) {
+			break;
+		}
+	}
+}
+
+/* Cells to look up - spread over the board */
+static PosnType sample_cell(uint8_t rep) {
+	return position(rep % BOARD_WIDTH, (rep * 3) % BOARD_HEIGHT);
+}
+
+static void benchmark_lookups(void) {
+	uint8_t rep;
+	
+	for(rep = 0; rep < BENCHMARK_REPS; rep++) {
+		TIME(is_snake_at(sample_cell(rep)), samples[rep]);
+		TIME(food_at(sample_cell(rep)), other_samples[rep]);
+	}
+	report(PSTR("is_snake_at"), samples, BENCHMARK_REPS);
+	report(PSTR("food_at"), other_samples, BENCHMARK_REPS);
+}
+
+static void benchmark_food(void) {
+	PosnType posn;
+	uint8_t n;
+	
+	for(n = 0; n < BENCHMARK_REPS; n++) {
+		TIME(posn = add_food_item(), samples[n]);
+		if(!is_position_valid(posn)) {
+			break;
+		}
+		TIME(remove_food(food_at(posn)), other_samples[n]);
+	}
+	report(PSTR("add_food_item"), samples, n);
+	report(PSTR("remove_food"), other_samples, n);
+}
+
+/* The obvious breadth first search - a queue of cells and a distance for
+ * each - to compare the bitboard version against. Returns the distance
+ * to the nearest target, or if targets is NULL the number of cells that
+ * can be reached (as bitboard_flood_fill() does).
+ */
+static uint8_t queue_bfs(const Bitboard blocked, PosnType start,
+		const Bitboard targets) {
+	PosnType queue[BOARD_WIDTH * BOARD_HEIGHT];
+	uint8_t distances[BOARD_WIDTH * BOARD_HEIGHT];
+	uint8_t head = 0, tail = 0;
+	uint8_t distance, i;
+	PosnType cell, next;
+	
+	for(i = 0; i < BOARD_WIDTH * BOARD_HEIGHT; i++) {
+		distances[i] = UNREACHABLE;
+	}
+	distances[x_position(start) * BOARD_HEIGHT + y_position(start)] = 0;
+	queue[tail++] = start;
+	while(head < tail) {
+		cell = queue[head++];
+		distance = distances[x_position(cell) * BOARD_HEIGHT + y_position(cell)];
+		if(targets && bitboard_test(targets, cell)) {
+			return distance;
+		}
+		for(uint8_t dirn = SNAKE_UP; dirn <= SNAKE_LEFT; dirn++) {
+			next = next_position(cell, dirn);
+			i = x_position(next) * BOARD_HEIGHT + y_position(next);
+			if(distances[i] == UNREACHABLE && !bitboard_test(blocked, next)) {
+				distances[i] = distance + 1;
+				queue[tail++] = next;
+			}
+		}
+	}
+	return targets ? UNREACHABLE : tail;
+}
+
+/* Searches from cells spread over the board, around the snake, to the
+ * food and the rat. The bitboard and queue versions must agree.
+ */
+static void benchmark_bfs(void) {
+	Bitboard blocked, targets, region;
+	PosnType start;
+	uint8_t rep, result, queue_result, differ = 0;
+	
+	get_snake_bitboard(blocked);
+	bitboard_clear(targets);
+	for(int8_t i = 0; i < get_num_food_items(); i++) {
+		bitboard_set(targets, get_position_of_food(i));
+	}
+	bitboard_set(targets, get_rat_pos());
+	
+	for(rep = 0; rep < BENCHMARK_REPS; rep++) {
+		start = sample_cell(rep);
+		TIME(result = bitboard_distance(blocked, start, targets), samples[rep]);
+		TIME(queue_result = queue_bfs(blocked, start, targets), other_samples[rep]);
+		differ |= (result != queue_result);
+	}
+	report(PSTR("bitboard_distance"), samples, BENCHMARK_REPS);
+	report(PSTR("queue_bfs_distance"), other_samples, BENCHMARK_REPS);
+	
+	for(rep = 0; rep < BENCHMARK_REPS; rep++) {
+		start = sample_cell(rep);
+		TIME(result = bitboard_flood_fill(blocked, start, region), samples[rep]);
+		TIME(queue_result = queue_bfs(blocked, start, NULL), other_samples[rep]);
+		differ |= (result != queue_result);
+	}
+	report(PSTR("bitboard_flood_fill"), samples, BENCHMARK_REPS);
+	report(PSTR("queue_bfs_flood_fill"), other_samples, BENCHMARK_REPS);
+	
+	if(differ) {
+		printf_P(PSTR("BFS results differ at length %u\n"), get_snake_length());
+	}
+}
+
+static void benchmark_rat(void) {
+	for(uint8_t rep = 0; rep < BENCHMARK_REPS; rep++) {
+		TIME(next_rat_pos(), samples[rep]);
+	}
+	report(PSTR("next_rat_pos"), samples, BENCHMARK_REPS);
+}
+
+/* Moving the head and tail separately keeps the snake the same length.
+ * The autopilot steers (untimed) so the snake doesn't run into itself.
+ */
+static void benchmark_snake(void) {
+	int8_t result;
+	uint8_t n;
+	
+	for(n = 0; n < BENCHMARK_REPS; n++) {
+		set_snake_dirn(autopilot_dirn());
+		TIME(result = advance_snake_head(), samples[n]);
+		if(result < 0) {
+			break;
+		}
+		TIME(advance_snake_tail(), other_samples[n]);
+	}
+	report(PSTR("advance_snake_head"), samples, n);
+	report(PSTR("advance_snake_tail"), other_samples, n);
+	
+	for(n = 0; n < BENCHMARK_REPS; n++) {
+		set_snake_dirn(autopilot_dirn());
+		TIME(result = attempt_to_move_snake_forward(), samples[n]);
+		if(!result) {
+			break;
+		}
+	}
+	report(PSTR("attempt_to_move_snake_forward"), samples, n);
+}
+
+/* Also checks the incrementally updated hash against one computed from
+ * scratch, after all the moves the other benchmarks have made.
+ */
+static void benchmark_zobrist(void) {
+	uint64_t hash = 0;
+	
+	for(uint8_t rep = 0; rep < BENCHMARK_REPS; rep++) {
+		TIME(hash = zobrist_compute(), samples[rep]);
+	}
+	report(PSTR("zobrist_compute"), samples, BENCHMARK_REPS);
+	if(hash != get_zobrist_hash()) {
+		printf_P(PSTR("Zobrist hash wrong at length %u\n"), get_snake_length());
+	}
+}
+
+/* Time the controllers' decisions over a few moves, each controller
+ * steering the snake in turn. A fresh autopilot plan is timed apart from
+ * following a plan already made (which is what most moves do).
+ */
+static void benchmark_controllers(void) {
+	SnakeDirnType dirn;
+	uint8_t n;
+	
+	for(n = 0; n < BENCHMARK_REPS; n++) {
+		TIME((init_autopilot(), dirn = autopilot_dirn()), samples[n]);
+		TIME(dirn = autopilot_dirn(), other_samples[n]);
+		set_snake_dirn(dirn);
+		if(!attempt_to_move_snake_forward()) {
+			n++;
+			break;
+		}
+	}
+	report(PSTR("autopilot_dirn_plan"), samples, n);
+	report(PSTR("autopilot_dirn"), other_samples, n);
+	
+	for(n = 0; n < BENCHMARK_REPS; n++) {
+		TIME(dirn = hamiltonian_dirn(), samples[n]);
+		set_snake_dirn(dirn);
+		if(!attempt_to_move_snake_forward()) {
+			n++;
+			break;
+		}
+	}
+	report(PSTR("hamiltonian_dirn"), samples, n);
+}
+
+static void benchmark_scrolling(void) {
+	set_scrolling_display_text(PSTR("BENCH"), COLOUR_GREEN);
+	for(uint8_t rep = 0; rep < BENCHMARK_REPS; rep++) {
+		TIME(scroll_display(), samples[rep]);
+	}
+	report(PSTR("scroll_display"), samples, BENCHMARK_REPS);
+}
+
+void run_benchmarks(void) {
+	uint16_t sample, least = UINT16_MAX;
+	
+	/* Count CPU cycles on timer 1 (normal mode, no prescaling) */
+	TIMSK1 = 0;
+	TCCR1A = 0;
+	TCCR1B = (1<<CS10);
+	
+	/* Don't draw the board on the terminal as the snake moves - it
+	 * would be timed too, and mixed in with the results
+	 */
+	ledmatrix_set_terminal_mirror(0);
+	
+	/* Find the cost of timing nothing */
+	overhead = 0;
+	for(uint8_t i = 0; i < 4; i++) {
+		TIME(, sample);
+		if(sample < least) {
+			least = sample;
+		}
+	}
+	overhead = least;
+	
+	clear_terminal();
+	move_cursor(1,1);
+	printf_P(PSTR("B,function,length,samples,min,median,max\n"));
+	for(uint8_t i = 0; i < sizeof(benchmark_lengths); i++) {
+		setup_game(pgm_read_byte(&benchmark_lengths[i]));
+		benchmark_lookups();
+		benchmark_food();
+		benchmark_bfs();
+		benchmark_rat();
+		benchmark_scrolling();
+		benchmark_snake();
+		benchmark_controllers();
+		benchmark_zobrist();
+	}
+	
+	ledmatrix_set_terminal_mirror(!get_telemetry_enabled());
+	
+	/* Wait until every line has gone out, so nothing the caller does
+	 * next (e.g. starting a new game) can get in the way of them
+	 */
+	while(!serial_output_empty()) {
+		; // wait
+	}
+}
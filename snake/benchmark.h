@@ -0,0 +1,39 @@
+/*
+ * benchmark.h
+ *
+ * Written by Hans Song
+ *
+ * Times the functions on the game's hot path, with the snake at several
+ * lengths, and writes the results to the terminal as comma separated
+ * values so runs on different versions of the code can be compared (see
+ * tools/bench_compare.py). Each line is
+ *	B,<function>,<snake length>,<samples>,<min>,<median>,<max>
+ * with times in CPU cycles. The bitboard searches (see bitboard.h) are
+ * timed alongside a plain queue based breadth first search (queue_bfs_*)
+ * doing the same job. A line is written if the two give different
+ * results, or if the incrementally updated Zobrist hash (see zobrist.h)
+ * doesn't match one computed from scratch.
+ *
+ * Timer 1 counts CPU cycles while the benchmarks run (so the seven
+ * segment display stops until the next game sets it up again). Interrupts
+ * are disabled around each timed call so they don't add to the times, and
+ * the board isn't drawn on the terminal (see
+ * ledmatrix_set_terminal_mirror()) so that isn't timed either. The timer
+ * is 16 bits, so a call taking 65536 cycles (8.2 ms) or more can't be
+ * timed - such a sample is recorded as 65535 and a line saying how many
+ * samples overflowed follows the function's B line.
+ * There are no caches on the AVR, so no warm up is needed - each
+ * function is timed BENCHMARK_REPS times and the minimum, median and
+ * maximum reported, which vary only with the data the function works on.
+ *
+ * The game state is used (and left in a mess), so a new game must be
+ * started afterwards. run_benchmarks() returns once all its output has
+ * been sent.
+ */
+
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+void run_benchmarks(void);
+
+#endif /* BENCHMARK_H_ */
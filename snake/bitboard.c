@@ -0,0 +1,146 @@
+/*
+ * bitboard.c
+ *
+ * Written by Hans Song
+ */
+
+#include "bitboard.h"
+#include "snake.h"
+
+/* Bits used in each row */
+#define ROW_MASK ((uint16_t)((1UL << BOARD_WIDTH) - 1))
+
+void bitboard_clear(Bitboard board) {
+	for(uint8_t y = 0; y < BOARD_HEIGHT; y++) {
+		board[y] = 0;
+	}
+}
+
+void bitboard_copy(const Bitboard from, Bitboard to) {
+	for(uint8_t y = 0; y < BOARD_HEIGHT; y++) {
+		to[y] = from[y];
+	}
+}
+
+void bitboard_set(Bitboard board, PosnType posn) {
+	board[y_position(posn) & (BOARD_HEIGHT - 1)] |= (1 << x_position(posn));
+}
+
+void bitboard_reset(Bitboard board, PosnType posn) {
+	board[y_position(posn) & (BOARD_HEIGHT - 1)] &= ~(1 << x_position(posn));
+}
+
+uint8_t bitboard_test(const Bitboard board, PosnType posn) {
+	return (board[y_position(posn) & (BOARD_HEIGHT - 1)] >> x_position(posn)) & 1;
+}
+
+uint8_t bitboard_is_empty(const Bitboard board) {
+	uint16_t any = 0;
+	for(uint8_t y = 0; y < BOARD_HEIGHT; y++) {
+		any |= board[y];
+	}
+	return any == 0;
+}
+
+uint8_t bitboard_count(const Bitboard board) {
+	uint8_t count = 0;
+	for(uint8_t y = 0; y < BOARD_HEIGHT; y++) {
+		uint16_t row = board[y];
+		/* Clear the lowest set bit until none are left */
+		while(row) {
+			row &= row - 1;
+			count++;
+		}
+	}
+	return count;
+}
+
+void get_snake_bitboard(Bitboard board) {
+	uint8_t length = get_snake_length();
+	bitboard_clear(board);
+	for(uint8_t i = 0; i < length; i++) {
+		bitboard_set(board, get_snake_position(i));
+	}
+}
+
+void bitboard_neighbours(const Bitboard from, Bitboard to) {
+	for(uint8_t y = 0; y < BOARD_HEIGHT; y++) {
+		uint16_t row = from[y];
+		/* Left and right within the row (rotating around the edges),
+		 * then the rows above and below (wrapping around)
+		 */
+		to[y] = (((row << 1) | (row >> (BOARD_WIDTH - 1)) |
+				(row >> 1) | (row << (BOARD_WIDTH - 1))) & ROW_MASK) |
+				from[(y + 1) % BOARD_HEIGHT] |
+				from[(y + BOARD_HEIGHT - 1) % BOARD_HEIGHT];
+	}
+}
+
+uint8_t bitboard_bfs_layer(const Bitboard blocked, Bitboard visited,
+		Bitboard frontier) {
+	Bitboard next;
+	uint16_t any = 0;
+	bitboard_neighbours(frontier, next);
+	for(uint8_t y = 0; y < BOARD_HEIGHT; y++) {
+		frontier[y] = next[y] & ~blocked[y] & ~visited[y];
+		visited[y] |= frontier[y];
+		any |= frontier[y];
+	}
+	return any != 0;
+}
+
+uint8_t bitboard_flood_fill(const Bitboard blocked, PosnType start,
+		Bitboard region) {
+	Bitboard frontier;
+	bitboard_clear(region);
+	bitboard_clear(frontier);
+	bitboard_set(region, start);
+	bitboard_set(frontier, start);
+	while(bitboard_bfs_layer(blocked, region, frontier)) {
+		;
+	}
+	return bitboard_count(region);
+}
+
+uint8_t bitboard_distance(const Bitboard blocked, PosnType start,
+		const Bitboard targets) {
+	Bitboard visited, frontier;
+	uint8_t distance = 0;
+	bitboard_clear(visited);
+	bitboard_clear(frontier);
+	bitboard_set(visited, start);
+	bitboard_set(frontier, start);
+	do {
+		for(uint8_t y = 0; y < BOARD_HEIGHT; y++) {
+			if(frontier[y] & targets[y]) {
+				return distance;
+			}
+		}
+		distance++;
+	} while(bitboard_bfs_layer(blocked, visited, frontier));
+	return UNREACHABLE;
+}
+
+void bitboard_distance_field(const Bitboard blocked, PosnType start,
+		uint8_t* distances) {
+	Bitboard visited, frontier;
+	uint8_t distance = 0;
+	for(uint8_t i = 0; i < BOARD_WIDTH * BOARD_HEIGHT; i++) {
+		distances[i] = UNREACHABLE;
+	}
+	bitboard_clear(visited);
+	bitboard_clear(frontier);
+	bitboard_set(visited, start);
+	bitboard_set(frontier, start);
+	do {
+		for(uint8_t y = 0; y < BOARD_HEIGHT; y++) {
+			uint16_t row = frontier[y];
+			for(uint8_t x = 0; row; x++, row >>= 1) {
+				if(row & 1) {
+					distances[x * BOARD_HEIGHT + y] = distance;
+				}
+			}
+		}
+		distance++;
+	} while(bitboard_bfs_layer(blocked, visited, frontier));
+}
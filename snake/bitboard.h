@@ -0,0 +1,83 @@
+/*
+ * bitboard.h
+ *
+ * Written by Hans Song
+ *
+ * Bitboards - a set of board cells stored as one bit per cell. Row y of
+ * the board is held in element y of the array, with column x in bit x.
+ * The 128 cell board therefore takes 16 bytes. (BOARD_HEIGHT must be a
+ * power of two and BOARD_WIDTH at most 16.)
+ *
+ * Whole sets of cells can be moved one step in every direction at once
+ * with shifts (rotations, since the snake wraps around the edges of the
+ * board) on each row and by moving between rows. This gives flood fill
+ * and breadth first search (BFS) a layer at a time, at a cost of a few
+ * hundred cycles per layer on the AVR. Since the board wraps around in
+ * both directions no cell is more than BOARD_WIDTH/2 + BOARD_HEIGHT/2
+ * (12) steps from another, so a complete fill takes at most 13 layers.
+ */
+
+#ifndef BITBOARD_H_
+#define BITBOARD_H_
+
+#include <stdint.h>
+#include "position.h"
+#include "board.h"
+
+typedef uint16_t Bitboard[BOARD_HEIGHT];
+
+/* Value in a distance field (see bitboard_distance_field()) for cells
+ * that can't be reached.
+ */
+#define UNREACHABLE 0xFF
+
+/* Basic operations on single cells and whole boards */
+void bitboard_clear(Bitboard board);
+void bitboard_copy(const Bitboard from, Bitboard to);
+void bitboard_set(Bitboard board, PosnType posn);
+void bitboard_reset(Bitboard board, PosnType posn);
+uint8_t bitboard_test(const Bitboard board, PosnType posn);
+uint8_t bitboard_is_empty(const Bitboard board);
+
+/* Return the number of cells in the set. */
+uint8_t bitboard_count(const Bitboard board);
+
+/* Set board to the cells occupied by the snake. */
+void get_snake_bitboard(Bitboard board);
+
+/* Set to the cells that are one step (up, down, left or right, wrapping
+ * around the edges) from any cell in from. (from and to must differ.)
+ */
+void bitboard_neighbours(const Bitboard from, Bitboard to);
+
+/* Advance a breadth first search by one layer. frontier holds the cells
+ * reached in the last layer and visited all cells reached so far. The
+ * unvisited, unblocked neighbours of the frontier become the new frontier
+ * and are added to visited. Returns 1 if the new frontier is not empty,
+ * 0 when the search is complete.
+ */
+uint8_t bitboard_bfs_layer(const Bitboard blocked, Bitboard visited,
+		Bitboard frontier);
+
+/* Set region to every cell reachable from start without passing through
+ * blocked cells. (The start cell itself is included even if it is
+ * blocked, e.g. when it is the snake's head.) Returns the size of the
+ * region.
+ */
+uint8_t bitboard_flood_fill(const Bitboard blocked, PosnType start,
+		Bitboard region);
+
+/* Return the number of steps from start to the nearest cell in targets
+ * (without passing through blocked cells) or UNREACHABLE.
+ */
+uint8_t bitboard_distance(const Bitboard blocked, PosnType start,
+		const Bitboard targets);
+
+/* Fill in distances (BOARD_WIDTH * BOARD_HEIGHT bytes, indexed by
+ * x * BOARD_HEIGHT + y) with the number of steps from start to every
+ * cell, or UNREACHABLE.
+ */
+void bitboard_distance_field(const Bitboard blocked, PosnType start,
+		uint8_t* distances);
+
+#endif /* BITBOARD_H_ */
@@ -8,8 +8,16 @@
 #ifndef BOARD_H_
 #define BOARD_H_
 
-// Useful constants that define the size of the board
+// Useful constants that define the size of the board. These can be
+// overridden when building (e.g. -DBOARD_WIDTH=4 -DBOARD_HEIGHT=4) to try
+// out the rules on smaller boards. The LED matrix is 16x8, so smaller
+// boards only use part of it. (The bitboards need a height which is a
+// power of two and a width of at most 16.)
+#ifndef BOARD_WIDTH
 #define BOARD_WIDTH 16
+#endif
+#ifndef BOARD_HEIGHT
 #define BOARD_HEIGHT 8
+#endif
 
 #endif /* BOARD_H_ */
\ No newline at end of file
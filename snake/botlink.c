@@ -0,0 +1,135 @@
+/*
+ * botlink.c
+ *
+ * Written by Hans Song
+ */
+
+#include "botlink.h"
+#include "frame.h"
+#include "snake.h"
+#include "zobrist.h"
+#include "replay.h"
+
+static FrameParser parser;
+
+/* Queue of moves waiting to be used. next_seq is the sequence number of
+ * the move after the last one queued.
+ */
+static uint8_t queue[BOT_QUEUE_SIZE];
+static uint8_t queue_start;
+static uint8_t queue_length;
+static uint8_t next_seq;
+
+/* Whether any command has been received (replies are only sent once one
+ * has), lockstep mode is on and a queued move was used for this step.
+ */
+static uint8_t bot_active;
+static uint8_t lockstep;
+static uint8_t used_move;
+
+/* Snake steps since the rat last moved in lockstep mode */
+static uint8_t rat_steps;
+
+static void send_status(uint8_t flags) {
+	uint32_t digest = get_zobrist_hash();
+	
+	if(lockstep) {
+		flags |= BOT_STATUS_LOCKSTEP;
+	}
+	frame_open(BOT_STATUS, 8);
+	frame_put(next_seq);
+	frame_put(queue_length);
+	frame_put(flags);
+	frame_put(get_snake_length());
+	for(uint8_t i = 0; i < 4; i++) {
+		frame_put(digest & 0xFF);
+		digest >>= 8;
+	}
+	frame_close();
+}
+
+static void queue_moves(uint8_t seq, const uint8_t* moves, uint8_t num_moves) {
+	/* Skip moves we already have. If the frame starts after the next
+	 * move we expect (or is so old it has wrapped around) it is ignored.
+	 */
+	uint8_t skip = next_seq - seq;
+	if(skip >= num_moves) {
+		return;
+	}
+	for(uint8_t i = skip; i < num_moves && queue_length < BOT_QUEUE_SIZE; i++) {
+		queue[(queue_start + queue_length) % BOT_QUEUE_SIZE] = moves[i] & 0x03;
+		queue_length++;
+		next_seq++;
+	}
+}
+
+uint8_t bot_parse_byte(uint8_t byte) {
+	uint8_t result = frame_parse_byte(&parser, byte);
+	
+	if(result != FRAME_COMPLETE) {
+		return result != FRAME_NOT_MINE;
+	}
+	if(parser.type == BOT_MOVES && parser.length >= 1) {
+		queue_moves(parser.payload[0], &parser.payload[1], parser.length - 1);
+	} else if(parser.type == BOT_LOCKSTEP && parser.length == 1) {
+		lockstep = parser.payload[0];
+	} else {
+		/* Not a command - e.g. our own frames echoed back */
+		return 1;
+	}
+	bot_active = 1;
+	send_status(BOT_STATUS_ALIVE);
+	return 1;
+}
+
+uint8_t bot_parse_in_progress(void) {
+	return frame_in_progress(&parser);
+}
+
+void bot_parse_reset(void) {
+	frame_parse_reset(&parser);
+}
+
+void bot_new_game(void) {
+	queue_start = 0;
+	queue_length = 0;
+	lockstep = 0;
+	rat_steps = 0;
+	if(bot_active) {
+		send_status(BOT_STATUS_ALIVE | BOT_STATUS_NEW_GAME);
+	}
+}
+
+uint8_t bot_lockstep(void) {
+	return lockstep;
+}
+
+uint8_t bot_move_ready(void) {
+	return queue_length != 0;
+}
+
+uint8_t bot_rat_step_due(void) {
+	if(!lockstep || ++rat_steps < BOT_LOCKSTEP_RAT_STEPS) {
+		return 0;
+	}
+	rat_steps = 0;
+	return 1;
+}
+
+void bot_before_move(void) {
+	used_move = (queue_length != 0);
+	if(!used_move) {
+		return;
+	}
+	set_snake_dirn(queue[queue_start]);
+	replay_record_arg(REPLAY_EVENT_BOT, queue[queue_start]);
+	queue_start = (queue_start + 1) % BOT_QUEUE_SIZE;
+	queue_length--;
+}
+
+void bot_after_move(uint8_t alive) {
+	if(bot_active) {
+		send_status((alive ? BOT_STATUS_ALIVE : 0) | BOT_STATUS_MOVED |
+				(used_move ? BOT_STATUS_BOT_MOVE : 0));
+	}
+}
@@ -0,0 +1,97 @@
+/*
+ * botlink.h
+ *
+ * Written by Hans Song
+ *
+ * Binary command channel for programs on the host that play the game
+ * ("bots"), in place of the cursor key escape sequences a terminal sends.
+ * Commands and replies are frames as described in frame.h, mixed in with
+ * the normal serial traffic.
+ *
+ * Commands (host to board):
+ *	BOT_MOVES - sequence number of the first move, then up to
+ *		FRAME_MAX_PAYLOAD-1 directions (SnakeDirnType), one per snake step.
+ *		Moves are queued (up to BOT_QUEUE_SIZE) and one is used per step.
+ *		Sequence numbers count moves (modulo 256); moves already accepted
+ *		are ignored, so a frame can simply be sent again if its status
+ *		went missing. A frame starting past the next expected sequence
+ *		number is ignored, as are moves that don't fit in the queue - the
+ *		next_seq in the replies says where to carry on from.
+ *	BOT_LOCKSTEP - one byte, non-zero to turn lockstep mode on. In
+ *		lockstep mode the snake only moves when a move is queued (as soon
+ *		as one is, rather than waiting for the move delay), and the rat
+ *		moves every BOT_LOCKSTEP_RAT_STEPS snake steps rather than every
+ *		second, so a bot can drive the game as fast as the UART allows.
+ *		(Super food still comes and goes with the clock.) Lockstep mode
+ *		is turned off at the start of every game, so a bot has to turn it
+ *		on again when it sees BOT_STATUS_NEW_GAME - otherwise a player
+ *		taking over after a bot has gone would be left with a snake that
+ *		never moves.
+ * Characters outside frames are handled as usual - e.g. send 'n' for a new
+ * game after game over.
+ *
+ * Replies (board to host): a BOT_STATUS frame after each snake step, after
+ * each command and at the start of each game, once any command has been
+ * received. Its payload is
+ *	0	next_seq - sequence number of the next move that will be accepted
+ *	1	number of moves queued
+ *	2	flags (BOT_STATUS_*)
+ *	3	snake length
+ *	4-7	state digest - the least significant 32 bits of the game's Zobrist
+ *		hash (see zobrist.h), least significant byte first. The keys
+ *		aren't published, so this is only a change detector: equal
+ *		digests mean (almost certainly) equal game states, e.g. to spot
+ *		that a step or command changed nothing.
+ */
+
+#ifndef BOTLINK_H_
+#define BOTLINK_H_
+
+#include <stdint.h>
+
+#define BOT_MOVES		0x11
+#define BOT_LOCKSTEP	0x12
+#define BOT_STATUS		0x21
+
+#define BOT_STATUS_ALIVE		0x01	/* snake is alive */
+#define BOT_STATUS_MOVED		0x02	/* reply to a snake step */
+#define BOT_STATUS_BOT_MOVE		0x04	/* ...which used a queued move */
+#define BOT_STATUS_NEW_GAME		0x08	/* a new game has just started */
+#define BOT_STATUS_LOCKSTEP		0x10	/* lockstep mode is on */
+
+#define BOT_QUEUE_SIZE 16
+#define BOT_LOCKSTEP_RAT_STEPS 2
+
+/* Offer a received serial byte to the command parser. Returns non-zero if
+ * the byte was part of a command frame (and so should not be processed as
+ * a key press).
+ */
+uint8_t bot_parse_byte(uint8_t byte);
+
+/* Whether a command frame is part way through being received, and throw
+ * away a partly received one.
+ */
+uint8_t bot_parse_in_progress(void);
+void bot_parse_reset(void);
+
+/* Start of a game - empties the move queue and turns lockstep mode off. */
+void bot_new_game(void);
+
+/* Whether lockstep mode is on, and (in lockstep mode) whether the snake
+ * should move now.
+ */
+uint8_t bot_lockstep(void);
+uint8_t bot_move_ready(void);
+
+/* In lockstep mode, whether the rat should move now. Call once after each
+ * move of the snake.
+ */
+uint8_t bot_rat_step_due(void);
+
+/* Call just before/after each move of the snake. Before the move the next
+ * queued move (if any) sets the snake's direction.
+ */
+void bot_before_move(void);
+void bot_after_move(uint8_t alive);
+
+#endif /* BOTLINK_H_ */
@@ -8,6 +8,8 @@
 #include <avr/interrupt.h>
 #include <stdio.h>
 #include "buttons.h"
+#include "trace.h"
+#include "latency.h"
 
 uint16_t joystick_value;
 uint8_t x_or_y = 0; // 0 = x, 1 = y
@@ -100,6 +102,8 @@ ISR(PCINT1_vect) {
 				// processing (i.e. ignore other button events if there
 				// are any)
 				button_queue[queue_length++] = pin;
+				TRACE(TRACE_BUTTON, pin);
+				LATENCY_MARK(LATENCY_BUTTON);
 				if(queue_length >= BUTTON_QUEUE_SIZE) {
 					break;
 				}
@@ -0,0 +1,95 @@
+/*
+ * controller.c
+ *
+ * Written by Hans Song
+ */
+
+#include "controller.h"
+#include "autopilot.h"
+#include "hamiltonian.h"
+#include "mcts.h"
+#include "neural.h"
+#include "snake.h"
+#include "replay.h"
+#include "timer0.h"
+#include "score.h"
+
+static uint8_t current_controller = CONTROLLER_HUMAN;
+static uint16_t max_time;
+
+/* Whether the controller has steered since the start of the game */
+static uint8_t whole_game;
+
+void set_controller(uint8_t controller) {
+	current_controller = controller;
+}
+
+uint8_t get_controller(void) {
+	return current_controller;
+}
+
+void toggle_controller(uint8_t controller) {
+	if(current_controller == controller) {
+		set_controller(CONTROLLER_HUMAN);
+	} else {
+		set_controller(controller);
+	}
+	init_controller();
+	whole_game = 0;
+}
+
+void init_controller(void) {
+	replay_record_arg(REPLAY_EVENT_CONTROLLER, current_controller);
+	max_time = 0;
+	whole_game = 1;
+	if(current_controller == CONTROLLER_AUTOPILOT) {
+		init_autopilot();
+	} else if(current_controller == CONTROLLER_NEURAL) {
+		init_neural();
+	}
+}
+
+void controller_game_over(void) {
+	if(current_controller == CONTROLLER_NEURAL && whole_game) {
+		// A game the network joined part way through isn't a fair
+		// test of it
+		neural_game_over(get_score());
+	}
+}
+
+void controller_before_move(void) {
+	uint32_t start_time;
+	uint32_t time_taken;
+	SnakeDirnType dirn;
+	
+	if(current_controller == CONTROLLER_HUMAN) {
+		return;
+	}
+	start_time = get_clock_micros();
+	switch(current_controller) {
+		case CONTROLLER_HAMILTONIAN:
+			dirn = hamiltonian_dirn();
+			break;
+		case CONTROLLER_MCTS:
+			dirn = mcts_dirn();
+			break;
+		case CONTROLLER_NEURAL:
+			dirn = neural_dirn();
+			break;
+		case CONTROLLER_AUTOPILOT:
+		default:
+			dirn = autopilot_dirn();
+			break;
+	}
+	set_snake_dirn(dirn);
+	replay_record_arg(REPLAY_EVENT_CONTROLLER_MOVE, dirn);
+	
+	time_taken = get_clock_micros() - start_time;
+	if(time_taken > max_time) {
+		max_time = (time_taken > UINT16_MAX) ? UINT16_MAX : time_taken;
+	}
+}
+
+uint16_t get_controller_max_time(void) {
+	return max_time;
+}
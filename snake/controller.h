@@ -0,0 +1,55 @@
+/*
+ * controller.h
+ *
+ * Written by Hans Song
+ *
+ * Built in controllers which can steer the snake in place of the player.
+ * When a controller other than CONTROLLER_HUMAN is selected it is asked
+ * for a direction just before each move of the snake. (Input from the
+ * player is still processed but the controller has the final say.)
+ */
+
+#ifndef CONTROLLER_H_
+#define CONTROLLER_H_
+
+#include <stdint.h>
+
+#define CONTROLLER_HUMAN		0
+#define CONTROLLER_AUTOPILOT	1
+#define CONTROLLER_HAMILTONIAN	2
+#define CONTROLLER_MCTS			3
+#define CONTROLLER_NEURAL		4
+#define NUM_CONTROLLERS			5
+
+/* Select the controller for the next game (see init_controller()). The
+ * choice stays in effect across games until changed.
+ */
+void set_controller(uint8_t controller);
+uint8_t get_controller(void);
+
+/* Select the given controller, or go back to the player if it is
+ * already selected, straight away (part way through a game).
+ */
+void toggle_controller(uint8_t controller);
+
+/* Reset the selected controller for a new game (and record which one
+ * it is in the replay).
+ */
+void init_controller(void);
+
+/* Let the selected controller know the game is over (so it can learn
+ * from it).
+ */
+void controller_game_over(void);
+
+/* If a built in controller is selected, ask it which way to go and set
+ * the snake's direction. Must be called just before the snake moves.
+ */
+void controller_before_move(void);
+
+/* Longest time (in microseconds) the controller has taken to choose a
+ * move this game.
+ */
+uint16_t get_controller_max_time(void);
+
+#endif /* CONTROLLER_H_ */
@@ -0,0 +1,180 @@
+/*
+ * exporter.c
+ *
+ * Written by Hans Song
+ */
+
+#include <stdio.h>
+#include <avr/pgmspace.h>
+
+#include "exporter.h"
+#include "bitboard.h"
+#include "snake.h"
+#include "food.h"
+#include "rat.h"
+#include "superfood.h"
+#include "score.h"
+#include "serialio.h"
+
+#define RECORD_SNAKE		0
+#define RECORD_FOOD			16
+#define RECORD_HEAD			32
+#define RECORD_SUPER_FOOD	33
+#define RECORD_RAT			34
+#define RECORD_DIRN			35
+#define RECORD_ACTION		36
+#define RECORD_REWARD		37
+
+/* The two record buffers. filling is the buffer the current move's record
+ * is going into (-1 if it is being dropped) and sending the one to go
+ * out next. full[] is set once a record is finished.
+ */
+static uint8_t records[2][EXPORT_RECORD_SIZE];
+static uint8_t full[2];
+static int8_t filling = -1;
+static uint8_t sending;
+
+static uint8_t export_enabled;
+static uint16_t dropped;
+static uint32_t score_before_move;
+
+static const char hex_digits[16] PROGMEM = "0123456789ABCDEF";
+
+void toggle_export(void) {
+	export_enabled = !export_enabled;
+	full[0] = 0;
+	full[1] = 0;
+	filling = -1;
+	sending = 0;
+	dropped = 0;
+}
+
+uint8_t get_export_enabled(void) {
+	return export_enabled;
+}
+
+static void put_bitboard(uint8_t* record, const Bitboard board) {
+	for(uint8_t y = 0; y < BOARD_HEIGHT; y++) {
+		record[2 * y] = board[y] & 0xFF;
+		record[2 * y + 1] = board[y] >> 8;
+	}
+}
+
+void export_before_move(void) {
+	Bitboard board;
+	uint8_t* record;
+	
+	if(!export_enabled) {
+		return;
+	}
+	/* Fill whichever buffer isn't waiting to be sent */
+	if(!full[sending]) {
+		filling = sending;
+	} else if(!full[sending ^ 1]) {
+		filling = sending ^ 1;
+	} else {
+		filling = -1;
+		dropped++;
+		return;
+	}
+	record = records[filling];
+	
+	get_snake_bitboard(board);
+	put_bitboard(&record[RECORD_SNAKE], board);
+	bitboard_clear(board);
+	for(int8_t i = 0; i < get_num_food_items(); i++) {
+		bitboard_set(board, get_position_of_food(i));
+	}
+	put_bitboard(&record[RECORD_FOOD], board);
+	record[RECORD_HEAD] = get_snake_head_position();
+	record[RECORD_SUPER_FOOD] = get_super_food_existence() ?
+			get_super_food_pos() : INVALID_POSITION;
+	record[RECORD_RAT] = get_rat_pos();
+	record[RECORD_DIRN] = get_snake_dirn();
+	score_before_move = get_score();
+}
+
+void export_after_move(uint8_t alive) {
+	uint32_t reward;
+	
+	if(!export_enabled || filling < 0) {
+		return;
+	}
+	reward = get_score() - score_before_move;
+	records[filling][RECORD_ACTION] = get_snake_dirn();
+	if(!alive) {
+		records[filling][RECORD_REWARD] = (uint8_t)EXPORT_REWARD_DIED;
+	} else {
+		records[filling][RECORD_REWARD] = (reward > INT8_MAX) ? INT8_MAX : reward;
+	}
+	full[filling] = 1;
+	filling = -1;
+}
+
+static void put_hex(uint8_t byte) {
+	putchar(pgm_read_byte(&hex_digits[byte >> 4]));
+	putchar(pgm_read_byte(&hex_digits[byte & 0x0F]));
+}
+
+#ifdef EXPORT_COMPRESS
+/* Send (or just count, if send is 0) the bytes of a record with each run
+ * of zeros replaced by a zero and the length of the run. Returns the
+ * number of bytes.
+ */
+static uint8_t encode_record(const uint8_t* record, uint8_t send) {
+	uint8_t length = 0, run;
+	for(uint8_t i = 0; i < EXPORT_RECORD_SIZE; i++) {
+		if(record[i] == 0) {
+			for(run = 1; i + 1 < EXPORT_RECORD_SIZE && record[i + 1] == 0; run++) {
+				i++;
+			}
+			if(send) {
+				put_hex(0);
+				put_hex(run);
+			}
+			length += 2;
+		} else {
+			if(send) {
+				put_hex(record[i]);
+			}
+			length++;
+		}
+	}
+	return length;
+}
+#define RECORD_TYPE 'Z'
+#else
+static uint8_t encode_record(const uint8_t* record, uint8_t send) {
+	if(send) {
+		for(uint8_t i = 0; i < EXPORT_RECORD_SIZE; i++) {
+			put_hex(record[i]);
+		}
+	}
+	return EXPORT_RECORD_SIZE;
+}
+#define RECORD_TYPE 'X'
+#endif
+
+void export_poll(void) {
+	const uint8_t* record = records[sending];
+	
+	if(!export_enabled || !full[sending]) {
+		return;
+	}
+	/* ESC _ X, two hex digits per byte, then ESC \ */
+	if(serial_output_space() < 2 * encode_record(record, 0) + 5) {
+		return;
+	}
+	putchar('\x1b');
+	putchar('_');
+	putchar(RECORD_TYPE);
+	encode_record(record, 1);
+	putchar('\x1b');
+	putchar('\\');
+	full[sending] = 0;
+	sending ^= 1;
+}
+
+uint16_t get_export_dropped(void) {
+	return dropped;
+}
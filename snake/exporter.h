@@ -0,0 +1,58 @@
+/*
+ * exporter.h
+ *
+ * Written by Hans Song
+ *
+ * Exports (state, action, reward) records for every move of the snake so
+ * games can be used as training data off the board. Each record has the
+ * same fixed size and layout (EXPORT_RECORD_SIZE bytes):
+ *	0-15	cells occupied by the snake, as a bitboard (see bitboard.h),
+ *			row 0 first, each row least significant byte first
+ *	16-31	cells holding food, as a bitboard
+ *	32		snake head position
+ *	33		super food position (INVALID_POSITION if there is none)
+ *	34		rat position
+ *	35		snake direction before the move (SnakeDirnType)
+ *	36		direction moved (the action)
+ *	37		reward: points scored by the move (up to 127), or
+ *			EXPORT_REWARD_DIED (-128) if the snake died
+ *
+ * Records are streamed over the UART as hex inside ANSI application
+ * program command strings, one record per string: ESC _ X <hex> ESC \
+ * (or ESC _ Z <hex> ESC \ when EXPORT_COMPRESS is defined, in which case
+ * each run of zero bytes is sent as a zero byte followed by the length of
+ * the run - the bitboards are mostly zeros).
+ *
+ * Records are double buffered: one is filled during the move while the
+ * other waits for room in the UART output buffer. Writing never waits for
+ * the UART; if both buffers are still full when a move happens, that
+ * move's record is dropped (and counted).
+ */
+
+#ifndef EXPORTER_H_
+#define EXPORTER_H_
+
+#include <stdint.h>
+
+#define EXPORT_RECORD_SIZE 38
+#define EXPORT_REWARD_DIED (-128)
+
+/* Turn exporting on or off, and find out whether it is on. */
+void toggle_export(void);
+uint8_t get_export_enabled(void);
+
+/* Call just before/after each move of the snake. The state is captured
+ * before the move; the action and reward after it.
+ */
+void export_before_move(void);
+void export_after_move(uint8_t alive);
+
+/* Stream out any finished record if the UART output buffer has room.
+ * Should be called regularly from the game loop.
+ */
+void export_poll(void);
+
+/* Number of records dropped because the UART could not keep up. */
+uint16_t get_export_dropped(void);
+
+#endif /* EXPORTER_H_ */
@@ -14,6 +14,8 @@
 #include "snake.h"
 #include "board.h"
 #include "timer0.h"
+#include "game.h"
+#include "zobrist.h"
 
 /*
 ** Global variables.
@@ -72,12 +74,11 @@ PosnType add_food_item(void) {
 	x = 0;
 	y = 0;
 	attempts = 0;
-	srandom(get_clock_ticks());
 	do {
 		// Generate a new position - this is based on a sequence rather
 		// then being random
-        x = random()%BOARD_WIDTH;
-        y = random()%BOARD_HEIGHT;
+        x = game_random()%BOARD_WIDTH;
+        y = game_random()%BOARD_HEIGHT;
 		test_position = position(x,y);
         attempts++;
     } while(attempts < 100 && 
@@ -96,6 +97,7 @@ PosnType add_food_item(void) {
 	int8_t newFoodID = numFoodItems;
 	foodPositions[newFoodID] = test_position;
 	numFoodItems++;
+	zobrist_toggle(ZOBRIST_FOOD, test_position);
 	return test_position;
 }
 
@@ -116,6 +118,7 @@ void remove_food(int8_t foodID) {
         /* Invalid foodID */
         return;
     }
+	zobrist_toggle(ZOBRIST_FOOD, foodPositions[foodID]);
 	     
     /* Shuffle our list of food items along so there are
 	** no holes in our list 
@@ -0,0 +1,82 @@
+/*
+ * frame.c
+ *
+ * Written by Hans Song
+ */
+
+#include <util/crc16.h>
+
+#include "frame.h"
+#include "serialio.h"
+
+/* Parser states - waiting for the sync byte, then the type, length,
+ * payload and CRC
+ */
+#define PARSE_SYNC		0
+#define PARSE_TYPE		1
+#define PARSE_LENGTH	2
+#define PARSE_PAYLOAD	3
+#define PARSE_CRC		4
+
+/* CRC of the frame being sent */
+static uint8_t out_crc;
+
+void frame_open(uint8_t type, uint8_t length) {
+	serial_write_byte(FRAME_SYNC);
+	out_crc = 0;
+	frame_put(type);
+	frame_put(length);
+}
+
+void frame_put(uint8_t byte) {
+	out_crc = _crc8_ccitt_update(out_crc, byte);
+	serial_write_byte(byte);
+}
+
+void frame_close(void) {
+	serial_write_byte(out_crc);
+}
+
+uint8_t frame_parse_byte(FrameParser* parser, uint8_t byte) {
+	switch(parser->state) {
+		case PARSE_SYNC:
+			if(byte != FRAME_SYNC) {
+				return FRAME_NOT_MINE;
+			}
+			parser->crc = 0;
+			parser->state = PARSE_TYPE;
+			return FRAME_PARTIAL;
+		case PARSE_TYPE:
+			parser->type = byte;
+			parser->state = PARSE_LENGTH;
+			break;
+		case PARSE_LENGTH:
+			if(byte > FRAME_MAX_PAYLOAD) {
+				parser->state = PARSE_SYNC;
+				return FRAME_BAD;
+			}
+			parser->length = byte;
+			parser->count = 0;
+			parser->state = byte ? PARSE_PAYLOAD : PARSE_CRC;
+			break;
+		case PARSE_PAYLOAD:
+			parser->payload[parser->count++] = byte;
+			if(parser->count == parser->length) {
+				parser->state = PARSE_CRC;
+			}
+			break;
+		default:
+			parser->state = PARSE_SYNC;
+			return (byte == parser->crc) ? FRAME_COMPLETE : FRAME_BAD;
+	}
+	parser->crc = _crc8_ccitt_update(parser->crc, byte);
+	return FRAME_PARTIAL;
+}
+
+uint8_t frame_in_progress(FrameParser* parser) {
+	return parser->state != PARSE_SYNC;
+}
+
+void frame_parse_reset(FrameParser* parser) {
+	parser->state = PARSE_SYNC;
+}
@@ -0,0 +1,57 @@
+/*
+ * frame.h
+ *
+ * Written by Hans Song
+ *
+ * Framing for binary messages over the UART (in either direction). Each
+ * frame is
+ *	FRAME_SYNC, type, payload length n, n payload bytes, CRC-8
+ * where the CRC (polynomial 0x07, initial value 0) covers the type, length
+ * and payload. Text can be mixed in between frames; a reader skips
+ * anything that isn't a frame with a good CRC.
+ */
+
+#ifndef FRAME_H_
+#define FRAME_H_
+
+#include <stdint.h>
+
+#define FRAME_SYNC 0xA5
+
+/* Largest payload accepted by frame_parse_byte() */
+#define FRAME_MAX_PAYLOAD 16
+
+/* Send a frame: open it, put exactly length payload bytes, then close it.
+ * The bytes go straight to the UART (waiting for room if need be).
+ */
+void frame_open(uint8_t type, uint8_t length);
+void frame_put(uint8_t byte);
+void frame_close(void);
+
+/* Receiving. Bytes are fed in one at a time; the state of the frame being
+ * received is kept in a FrameParser (initially all zero).
+ */
+typedef struct {
+	uint8_t state;
+	uint8_t type;
+	uint8_t length;
+	uint8_t count;
+	uint8_t crc;
+	uint8_t payload[FRAME_MAX_PAYLOAD];
+} FrameParser;
+
+/* Results of frame_parse_byte() */
+#define FRAME_NOT_MINE	0	/* byte is not part of a frame */
+#define FRAME_PARTIAL	1	/* byte used - frame not finished yet */
+#define FRAME_COMPLETE	2	/* byte used - frame finished and in the parser */
+#define FRAME_BAD		3	/* byte used - frame was damaged or too long */
+
+uint8_t frame_parse_byte(FrameParser* parser, uint8_t byte);
+
+/* Return non-zero if the parser is part way through a frame, and throw
+ * away a partly received frame.
+ */
+uint8_t frame_in_progress(FrameParser* parser);
+void frame_parse_reset(FrameParser* parser);
+
+#endif /* FRAME_H_ */
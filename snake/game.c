@@ -5,6 +5,7 @@
  */ 
 
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "game.h"
 #include "snake.h"
@@ -15,6 +16,11 @@
 #include "ledmatrix.h"
 #include "timer0.h"
 #include "rat.h"
+#include "replay.h"
+#include "zobrist.h"
+#include "trace.h"
+#include "telemetry.h"
+#include "latency.h"
 
 // Colours that we'll use
 #define SNAKE_HEAD_COLOUR	COLOUR_RED
@@ -27,6 +33,13 @@
 /* decreasing delay before stepping snake, begins at 600 */
 volatile uint16_t move_delay = 600;
 
+/* Seed for the random sequence of the current game and the current
+** state of that sequence. We keep our own state (rather than using
+** random()) so that it can be saved in replay keyframes.
+*/
+static uint32_t game_seed;
+static unsigned long random_state;
+
 // Helper function
 static void update_display_at_position(PosnType posn, PixelColour colour) {
 	ledmatrix_update_pixel(x_position(posn), y_position(posn), colour);
@@ -37,10 +50,16 @@ static void update_display_at_position(PosnType posn, PixelColour colour) {
 */
 void super_food(void) {
 	if (get_super_food_status() && get_super_food_existence() == 0) {
+		replay_record(REPLAY_EVENT_SUPER_FOOD);
 		add_super_food();
+		TRACE(TRACE_SUPER_FOOD, get_super_food_pos());
+		telemetry_item(TELEMETRY_SUPER_FOOD, get_super_food_pos());
 		update_display_at_position(get_super_food_pos(), SUPERFOOD_COLOR);
 	} else if(get_super_food_status() == 0 && get_super_food_existence()) {
+		replay_record(REPLAY_EVENT_SUPER_FOOD);
 		remove_super_food();
+		TRACE(TRACE_SUPER_FOOD, INVALID_POSITION);
+		telemetry_item(TELEMETRY_SUPER_FOOD | TELEMETRY_REMOVED, get_super_food_pos());
 		update_display_at_position(get_super_food_pos(), BACKGROUND_COLOUR);
 	}
 }
@@ -48,6 +67,14 @@ void super_food(void) {
 void move_rat(void) {
 	update_display_at_position(get_rat_pos(), BACKGROUND_COLOUR);
 	PosnType newPos = next_rat_pos();
+	if(newPos == INVALID_POSITION) {
+		// Rat is boxed in and stays where it is
+		newPos = get_rat_pos();
+		TRACE(TRACE_RAT_STUCK, newPos);
+	} else {
+		TRACE(TRACE_RAT_MOVE, newPos);
+		telemetry_item(TELEMETRY_RAT, newPos);
+	}
 	update_display_at_position(newPos, RAT_COLOUR);
 }
 
@@ -57,6 +84,10 @@ void init_game(void) {
 	// Clear display
 	ledmatrix_clear();
 	
+	// Seed the random number generator once for the whole game. Nothing
+	// else reseeds it, so the game is determined by the seed and inputs.
+	random_state = game_seed;
+	
 	// Initialise the snake and display it. We know the initial snake is only
 	// of length two so we can just retrieve the tail and head positions
 	init_snake();
@@ -73,12 +104,18 @@ void init_game(void) {
 	}
 	add_rat();
 	update_display_at_position(get_rat_pos(), RAT_COLOUR);
+	
+	// The board is set up - compute its hash. From here on the hash is
+	// updated incrementally as things move.
+	zobrist_recompute();
 }
 
 // Attempt to move snake forward. Returns true if successful, false otherwise
 int8_t attempt_to_move_snake_forward(void) {
 	PosnType prior_head_position = get_snake_head_position();
+	PosnType prev_tail_posn = INVALID_POSITION;
 	int8_t move_result = advance_snake_head();
+	TRACE(TRACE_SNAKE_MOVE, move_result);
 	if(move_result < 0) {
 		// Snake moved out of bounds (if this is not permitted) or
 		// collided it with itself. Return false because we couldn't
@@ -96,17 +133,22 @@ int8_t attempt_to_move_snake_forward(void) {
 		if(move_result == ATE_SUPER_FOOD) {
 			remove_super_food();
 			ate_super_food();
+			telemetry_item(TELEMETRY_SUPER_FOOD | TELEMETRY_REMOVED, new_head_position);
 		}  else if(move_result == ATE_RAT) {
 			add_rat();
+			telemetry_item(TELEMETRY_RAT, get_rat_pos());
 			update_display_at_position(get_rat_pos(), RAT_COLOUR);
 		} else {
 			int8_t foodID = food_at(new_head_position);
 			remove_food(foodID);
+			TRACE(TRACE_FOOD_EATEN, new_head_position);
 			
 			// Add a new food item. Might fail if a free position can't be
 			// found on the board but shouldn't usually.
 			PosnType new_food_posn = add_food_item();
 			if(is_position_valid(new_food_posn)) {
+				TRACE(TRACE_FOOD_ADDED, new_food_posn);
+				telemetry_item(TELEMETRY_FOOD, new_food_posn);
 				update_display_at_position(new_food_posn, FOOD_COLOUR);
 			}
 		}
@@ -120,7 +162,7 @@ int8_t attempt_to_move_snake_forward(void) {
 	// maximum length, then we move the tail forward and remove this 
 	// element from the display
 	if(move_result == MOVE_OK || move_result == ATE_FOOD_BUT_CANT_GROW) {
-		PosnType prev_tail_posn = advance_snake_tail();
+		prev_tail_posn = advance_snake_tail();
 		update_display_at_position(prev_tail_posn, BACKGROUND_COLOUR);
 	}
 	
@@ -128,9 +170,31 @@ int8_t attempt_to_move_snake_forward(void) {
 	// update the new head position.
 	update_display_at_position(prior_head_position, SNAKE_BODY_COLOUR);
 	update_display_at_position(new_head_position, SNAKE_HEAD_COLOUR);
+	LATENCY_DRAWN_HEAD();
+	telemetry_step(new_head_position, prev_tail_posn);
 	return 1;
 }
 
+void set_game_seed(uint32_t seed) {
+	game_seed = seed;
+}
+
+uint32_t get_game_seed(void) {
+	return game_seed;
+}
+
+long game_random(void) {
+	return random_r(&random_state);
+}
+
+uint32_t get_game_random_state(void) {
+	return random_state;
+}
+
+void set_game_random_state(uint32_t state) {
+	random_state = state;
+}
+
 /* Gets the current delay before snake moves */
 uint16_t get_move_delay(void) {
 	return move_delay;
@@ -9,6 +9,23 @@
 
 #include <inttypes.h>
 
+// Set the seed used for the next game. Every random choice made during a
+// game (snake start, food, super food and rat positions) is drawn from a
+// single game_random() sequence seeded once by init_game(), so a game can
+// be reproduced from its seed and the timing of its inputs.
+void set_game_seed(uint32_t seed);
+
+// Returns the seed of the current (or next) game.
+uint32_t get_game_seed(void);
+
+// Returns the next number in the game's random sequence (as random() does).
+long game_random(void);
+
+// Get/set the state of the game's random sequence. Saving the state and
+// restoring it later continues the sequence from the same point.
+uint32_t get_game_random_state(void);
+void set_game_random_state(uint32_t state);
+
 // Initialise game. This initialises the board with snake and food items
 // and initialises the display.
 void init_game(void);
@@ -0,0 +1,198 @@
+/*
+ * hamiltonian.c
+ *
+ * Written by Hans Song
+ */
+
+#include <avr/pgmspace.h>
+
+#include "hamiltonian.h"
+#include "board.h"
+#include "snake.h"
+#include "food.h"
+#include "rat.h"
+#include "superfood.h"
+
+#define NUM_CELLS (BOARD_WIDTH * BOARD_HEIGHT)
+
+/* Minimum gap (in cells along the cycle) to keep between the head and the
+ * tail when taking a shortcut. This allows for the snake growing as it
+ * eats.
+ */
+#define SHORTCUT_MARGIN 4
+
+/* Shortcuts are only taken while the snake fills less than this many
+ * cells.
+ */
+#define SHORTCUT_MAX_LENGTH (NUM_CELLS / 2)
+
+/* The cycle runs up column 0, then back and forth along the rows (from
+ * the top row down) over the rest of the board, ending next to (0,0).
+ */
+#if BOARD_WIDTH == 16 && BOARD_HEIGHT == 8
+/* On the full size board it is held in tables, indexed by (x * 8 + y). cycle_successor
+ * gives the next cell (as a PosnType) and cycle_order gives the position
+ * of each cell in the cycle (0 to 127).
+ */
+static const PosnType cycle_successor[NUM_CELLS] PROGMEM = {
+	0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x17,
+	0x00, 0x21, 0x11, 0x23, 0x13, 0x25, 0x15, 0x27,
+	0x10, 0x31, 0x12, 0x33, 0x14, 0x35, 0x16, 0x37,
+	0x20, 0x41, 0x22, 0x43, 0x24, 0x45, 0x26, 0x47,
+	0x30, 0x51, 0x32, 0x53, 0x34, 0x55, 0x36, 0x57,
+	0x40, 0x61, 0x42, 0x63, 0x44, 0x65, 0x46, 0x67,
+	0x50, 0x71, 0x52, 0x73, 0x54, 0x75, 0x56, 0x77,
+	0x60, 0x81, 0x62, 0x83, 0x64, 0x85, 0x66, 0x87,
+	0x70, 0x91, 0x72, 0x93, 0x74, 0x95, 0x76, 0x97,
+	0x80, 0xA1, 0x82, 0xA3, 0x84, 0xA5, 0x86, 0xA7,
+	0x90, 0xB1, 0x92, 0xB3, 0x94, 0xB5, 0x96, 0xB7,
+	0xA0, 0xC1, 0xA2, 0xC3, 0xA4, 0xC5, 0xA6, 0xC7,
+	0xB0, 0xD1, 0xB2, 0xD3, 0xB4, 0xD5, 0xB6, 0xD7,
+	0xC0, 0xE1, 0xC2, 0xE3, 0xC4, 0xE5, 0xC6, 0xE7,
+	0xD0, 0xF1, 0xD2, 0xF3, 0xD4, 0xF5, 0xD6, 0xF7,
+	0xE0, 0xF0, 0xE2, 0xF2, 0xE4, 0xF4, 0xE6, 0xF6
+};
+
+static const uint8_t cycle_order[NUM_CELLS] PROGMEM = {
+	  0,   1,   2,   3,   4,   5,   6,   7,
+	127,  98,  97,  68,  67,  38,  37,   8,
+	126,  99,  96,  69,  66,  39,  36,   9,
+	125, 100,  95,  70,  65,  40,  35,  10,
+	124, 101,  94,  71,  64,  41,  34,  11,
+	123, 102,  93,  72,  63,  42,  33,  12,
+	122, 103,  92,  73,  62,  43,  32,  13,
+	121, 104,  91,  74,  61,  44,  31,  14,
+	120, 105,  90,  75,  60,  45,  30,  15,
+	119, 106,  89,  76,  59,  46,  29,  16,
+	118, 107,  88,  77,  58,  47,  28,  17,
+	117, 108,  87,  78,  57,  48,  27,  18,
+	116, 109,  86,  79,  56,  49,  26,  19,
+	115, 110,  85,  80,  55,  50,  25,  20,
+	114, 111,  84,  81,  54,  51,  24,  21,
+	113, 112,  83,  82,  53,  52,  23,  22
+};
+
+static uint8_t cell_index(PosnType posn) {
+	return (x_position(posn) << 3) | y_position(posn);
+}
+
+static PosnType cycle_next(PosnType posn) {
+	return pgm_read_byte(&cycle_successor[cell_index(posn)]);
+}
+
+static uint8_t cycle_position(PosnType posn) {
+	return pgm_read_byte(&cycle_order[cell_index(posn)]);
+}
+#else
+/* On other (smaller) boards it is worked out as needed. */
+#if BOARD_HEIGHT % 2
+#error "The Hamiltonian cycle needs an even board height"
+#endif
+
+static PosnType cycle_next(PosnType posn) {
+	uint8_t x = x_position(posn);
+	uint8_t y = y_position(posn);
+	uint8_t row = BOARD_HEIGHT - 1 - y;
+	
+	if(x == 0) {
+		return (y == BOARD_HEIGHT - 1) ? position(1, y) : position(0, y + 1);
+	} else if(row % 2 == 0) {
+		/* Row heading right */
+		return (x == BOARD_WIDTH - 1) ? position(x, y - 1) : position(x + 1, y);
+	} else if(x > 1) {
+		/* Row heading left */
+		return position(x - 1, y);
+	} else {
+		return (y == 0) ? position(0, 0) : position(x, y - 1);
+	}
+}
+
+static uint8_t cycle_position(PosnType posn) {
+	uint8_t x = x_position(posn);
+	uint8_t y = y_position(posn);
+	uint8_t row = BOARD_HEIGHT - 1 - y;
+	uint8_t start = BOARD_HEIGHT + row * (BOARD_WIDTH - 1);
+	
+	if(x == 0) {
+		return y;
+	}
+	return (row % 2 == 0) ? start + x - 1 : start + BOARD_WIDTH - 1 - x;
+}
+#endif
+
+/* Number of steps along the cycle from a to b */
+static uint8_t cycle_distance(PosnType a, PosnType b) {
+	uint8_t from = cycle_position(a);
+	uint8_t to = cycle_position(b);
+	return (to >= from) ? to - from : to + NUM_CELLS - from;
+}
+
+/* Return the cycle distance from the head to the nearest item the snake
+ * can eat.
+ */
+static uint8_t distance_to_nearest_item(PosnType head) {
+	uint8_t nearest = cycle_distance(head, get_rat_pos());
+	uint8_t distance;
+	for(int8_t i = 0; i < get_num_food_items(); i++) {
+		distance = cycle_distance(head, get_position_of_food(i));
+		if(distance < nearest) {
+			nearest = distance;
+		}
+	}
+	if(get_super_food_existence()) {
+		distance = cycle_distance(head, get_super_food_pos());
+		if(distance < nearest) {
+			nearest = distance;
+		}
+	}
+	return nearest;
+}
+
+/* Return 1 if the snake could move into the given cell next move. (The
+ * tail moves out of the way as the head moves.)
+ */
+static uint8_t is_free(PosnType posn) {
+	return !is_snake_at(posn) || posn == get_snake_tail_position();
+}
+
+SnakeDirnType hamiltonian_dirn(void) {
+	PosnType head = get_snake_head_position();
+	PosnType next = cycle_next(head);
+	SnakeDirnType reverse = (get_snake_dirn() + 2) % 4;
+	uint8_t dirn;
+	
+	if(get_snake_length() < SHORTCUT_MAX_LENGTH) {
+		/* Jump as far along the cycle as we can without passing the item
+		 * we're heading for or getting too close to the tail.
+		 */
+		uint8_t item_distance = distance_to_nearest_item(head);
+		uint8_t tail_distance = cycle_distance(head, get_snake_tail_position());
+		uint8_t best_distance = 1;
+		for(dirn = SNAKE_UP; dirn <= SNAKE_LEFT; dirn++) {
+			PosnType cell = next_position(head, dirn);
+			uint8_t distance = cycle_distance(head, cell);
+			if(dirn != reverse && is_free(cell) && distance > best_distance &&
+					distance <= item_distance &&
+					distance + SHORTCUT_MARGIN < tail_distance) {
+				best_distance = distance;
+				next = cell;
+			}
+		}
+	}
+	
+	for(dirn = SNAKE_UP; dirn <= SNAKE_LEFT; dirn++) {
+		if(next_position(head, dirn) == next && dirn != reverse && is_free(next)) {
+			return dirn;
+		}
+	}
+	
+	/* We can only get here if the snake isn't lying along the cycle, which
+	 * happens at the start of a game. Take any free cell.
+	 */
+	for(dirn = SNAKE_UP; dirn <= SNAKE_LEFT; dirn++) {
+		if(dirn != reverse && is_free(next_position(head, dirn))) {
+			return dirn;
+		}
+	}
+	return get_snake_dirn();
+}
@@ -0,0 +1,28 @@
+/*
+ * hamiltonian.h
+ *
+ * Written by Hans Song
+ *
+ * Hamiltonian cycle controller - a controller which never dies. The snake
+ * follows a fixed cycle which visits every cell of the board once before
+ * returning to its start: up column 0, then back and forth along the rows
+ * from the top row down. As long as the snake's body lies along the cycle
+ * behind its head it can't run into itself.
+ *
+ * Following the cycle alone takes up to 127 moves to reach an item, so
+ * the controller takes shortcuts: it may jump to a neighbouring cell
+ * further along the cycle provided it doesn't jump past the item it is
+ * heading for and it stays well clear (along the cycle) of its own tail.
+ * Shortcuts are only taken while the snake is short enough that the part
+ * of the cycle ahead of it has plenty of room.
+ */
+
+#ifndef HAMILTONIAN_H_
+#define HAMILTONIAN_H_
+
+#include "snake.h"
+
+/* Return the direction the snake should move in next. */
+SnakeDirnType hamiltonian_dirn(void);
+
+#endif /* HAMILTONIAN_H_ */
@@ -0,0 +1,117 @@
+/*
+ * input.c
+ *
+ * Written by Hans Song
+ */
+
+#include "input.h"
+#include "buttons.h"
+#include "serialio.h"
+#include "botlink.h"
+#include "timer0.h"
+#include "latency.h"
+
+#define ESCAPE_CHAR 27
+
+/* Decoder states */
+#define STATE_GROUND	0	/* not in a sequence */
+#define STATE_ESCAPE	1	/* had ESC */
+#define STATE_CSI		2	/* had ESC [ (or ESC O), reading parameters */
+
+static uint8_t state;
+static uint8_t param;
+static uint8_t param_done;
+static uint32_t sequence_start;
+static uint16_t timeouts;
+
+void reset_input(void) {
+	state = STATE_GROUND;
+	bot_parse_reset();
+}
+
+uint16_t get_input_timeouts(void) {
+	return timeouts;
+}
+
+static uint8_t add_event(InputEvent* events, uint8_t num_events, uint8_t type,
+		uint8_t value, uint8_t event_param) {
+	events[num_events].type = type;
+	events[num_events].value = value;
+	events[num_events].param = event_param;
+	return num_events + 1;
+}
+
+/* Decode a byte of an escape sequence. Returns 1 if the byte was used, 0
+ * if it ended the sequence without being part of it (it should then be
+ * decoded again from the ground state). *num_events is incremented if an
+ * event is added.
+ */
+static uint8_t decode_sequence(uint8_t c, InputEvent* events,
+		uint8_t* num_events) {
+	if(state == STATE_ESCAPE) {
+		if(c == '[' || c == 'O') {
+			state = STATE_CSI;
+			param = 0;
+			param_done = 0;
+			return 1;
+		}
+		state = STATE_GROUND;
+		return 0;
+	}
+	/* STATE_CSI */
+	if(c >= '0' && c <= '9') {
+		if(!param_done) {
+			uint16_t value = param * 10 + (c - '0');
+			param = (value > 255) ? 255 : value;
+		}
+	} else if(c >= 0x20 && c <= 0x3F) {
+		/* Parameter separator or other parameter/intermediate byte */
+		param_done = 1;
+	} else if(c >= 0x40 && c <= 0x7E) {
+		*num_events = add_event(events, *num_events, INPUT_ESCAPE, c, param);
+		state = STATE_GROUND;
+	} else {
+		/* Not allowed in a sequence - abandon it */
+		state = STATE_GROUND;
+		return 0;
+	}
+	return 1;
+}
+
+uint8_t get_input_events(InputEvent* events) {
+	uint8_t num_events = 0;
+	int8_t button;
+	int16_t c;
+	
+	LATENCY_TAKE(LATENCY_BUTTON);
+	while(num_events < INPUT_MAX_EVENTS && (button = button_pushed()) != -1) {
+		num_events = add_event(events, num_events, INPUT_BUTTON, button, 0);
+	}
+	
+	/* A sequence (or bot command) left part way through for too long is
+	 * thrown away
+	 */
+	if((state != STATE_GROUND || bot_parse_in_progress()) &&
+			!serial_input_available() &&
+			get_clock_ticks() - sequence_start > INPUT_SEQUENCE_TIMEOUT) {
+		reset_input();
+		timeouts++;
+	}
+	
+	LATENCY_TAKE(LATENCY_SERIAL);
+	while(num_events < INPUT_MAX_EVENTS && (c = serial_read_byte()) != -1) {
+		sequence_start = get_clock_ticks();
+		if(state != STATE_GROUND && decode_sequence(c, events, &num_events)) {
+			continue;
+		}
+		if(bot_parse_byte(c)) {
+			continue;
+		}
+		if(c == ESCAPE_CHAR) {
+			state = STATE_ESCAPE;
+		} else {
+			num_events = add_event(events, num_events, INPUT_KEY, c, 0);
+		}
+	}
+	return num_events;
+}
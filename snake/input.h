@@ -0,0 +1,57 @@
+/*
+ * input.h
+ *
+ * Written by Hans Song
+ *
+ * Collects the input waiting from the push buttons and the serial port
+ * and decodes it into a list of input events for the game loop. Every
+ * byte waiting in the serial input buffer is handled each time (rather
+ * than one per pass through the game loop), so input doesn't queue up
+ * behind the rest of the game.
+ *
+ * Serial input is decoded by a state machine which keeps its place
+ * between calls, so sequences can arrive in pieces:
+ *	- bot command frames (see botlink.h) are passed to the bot link and
+ *	  produce no events
+ *	- ANSI control sequences - ESC [ then any parameter bytes (digits and
+ *	  ;), intermediate bytes and a final byte - produce an INPUT_ESCAPE
+ *	  event holding the final byte and the first numeric parameter (0 if
+ *	  none). ESC O x (sent for cursor keys by terminals in application
+ *	  mode) is treated as ESC [ x.
+ *	- anything else produces an INPUT_KEY event
+ * A sequence (or bot command) that stops part way through for more than
+ * INPUT_SEQUENCE_TIMEOUT milliseconds is thrown away, so a lost byte
+ * can't swallow the next key press.
+ */
+
+#ifndef INPUT_H_
+#define INPUT_H_
+
+#include <stdint.h>
+
+#define INPUT_BUTTON	0	/* value is the button (0 to 3) */
+#define INPUT_KEY		1	/* value is the character */
+#define INPUT_ESCAPE	2	/* value is the final byte, param the first parameter */
+
+typedef struct {
+	uint8_t type;
+	uint8_t value;
+	uint8_t param;
+} InputEvent;
+
+#define INPUT_MAX_EVENTS 8
+#define INPUT_SEQUENCE_TIMEOUT 50
+
+/* Fill in events (room for INPUT_MAX_EVENTS) with the input received
+ * since the last call, button pushes first, and return how many there
+ * are. If there are more than fit, the rest are left for the next call.
+ */
+uint8_t get_input_events(InputEvent* events);
+
+/* Forget any partly received sequence (e.g. when starting a game). */
+void reset_input(void);
+
+/* Number of sequences thrown away because they timed out. */
+uint16_t get_input_timeouts(void);
+
+#endif /* INPUT_H_ */
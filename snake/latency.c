@@ -0,0 +1,140 @@
+/*
+ * latency.c
+ *
+ * Written by Hans Song
+ */
+
+#include "latency.h"
+
+#ifdef LATENCY_ENABLED
+
+#include <stdio.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#include "timer0.h"
+#include "terminalio.h"
+
+#define NO_SOURCE 0xFF
+
+/* Time (in microseconds - see get_clock_micros()) of the first input
+ * waiting from each source, with a bit set in marked for each source
+ * that has input waiting. These are set by interrupt handlers.
+ */
+static volatile uint32_t mark_time[NUM_LATENCY_SOURCES];
+static volatile uint8_t marked;
+
+/* The same, for the input the game loop is currently dealing with */
+static uint32_t taken_time[NUM_LATENCY_SOURCES];
+static uint8_t taken;
+
+/* Input whose direction is waiting for the snake to move */
+static uint8_t in_flight = NO_SOURCE;
+static uint32_t in_flight_time;
+
+static uint16_t histogram[NUM_LATENCY_SOURCES][NUM_LATENCY_STAGES]
+		[NUM_LATENCY_BUCKETS];
+
+static const char source_names[NUM_LATENCY_SOURCES][9] PROGMEM = {
+	"button", "serial", "joystick"
+};
+static const char stage_names[NUM_LATENCY_STAGES][6] PROGMEM = {
+	"dirn", "drawn"
+};
+
+void latency_mark(uint8_t source) {
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	if(!(marked & (1 << source))) {
+		mark_time[source] = get_clock_micros();
+		marked |= (1 << source);
+	}
+	if(interrupts_enabled) {
+		sei();
+	}
+}
+
+void latency_take(uint8_t source) {
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	if(marked & (1 << source)) {
+		taken_time[source] = mark_time[source];
+		taken |= (1 << source);
+		marked &= ~(1 << source);
+	} else {
+		taken &= ~(1 << source);
+	}
+	if(interrupts_enabled) {
+		sei();
+	}
+}
+
+/* Count a latency (in microseconds) in the histogram for the source and
+ * stage.
+ */
+static void latency_record(uint8_t source, uint8_t stage, uint32_t latency) {
+	uint16_t ms = latency / 1000;
+	uint8_t bucket = 0;
+	while(ms && bucket < NUM_LATENCY_BUCKETS - 1) {
+		ms >>= 1;
+		bucket++;
+	}
+	if(histogram[source][stage][bucket] != UINT16_MAX) {
+		histogram[source][stage][bucket]++;
+	}
+}
+
+void latency_input(int8_t button, char escape_char) {
+	uint8_t source;
+	if(button != -1) {
+		source = LATENCY_BUTTON;
+	} else if(escape_char != (char)-1) {
+		source = LATENCY_SERIAL;
+	} else {
+		source = LATENCY_JOYSTICK;
+	}
+	if(!(taken & (1 << source))) {
+		// Already timed (e.g. a joystick being held) or not marked
+		return;
+	}
+	taken &= ~(1 << source);
+	latency_record(source, LATENCY_DIRN,
+			get_clock_micros() - taken_time[source]);
+	in_flight = source;
+	in_flight_time = taken_time[source];
+}
+
+void latency_drawn(void) {
+	if(in_flight != NO_SOURCE) {
+		latency_record(in_flight, LATENCY_DRAWN,
+				get_clock_micros() - in_flight_time);
+		in_flight = NO_SOURCE;
+	}
+}
+
+void latency_reset(void) {
+	in_flight = NO_SOURCE;
+	taken = 0;
+}
+
+void latency_dump(void) {
+	move_cursor(1, 21);
+	printf_P(PSTR("L,source,stage"));
+	for(uint8_t i = 0; i < NUM_LATENCY_BUCKETS - 1; i++) {
+		printf_P(PSTR(",<%ums"), 1 << i);
+	}
+	printf_P(PSTR(",>=%ums\n"), 1 << (NUM_LATENCY_BUCKETS - 2));
+	for(uint8_t source = 0; source < NUM_LATENCY_SOURCES; source++) {
+		for(uint8_t stage = 0; stage < NUM_LATENCY_STAGES; stage++) {
+			printf_P(PSTR("L,%S,%S"), source_names[source],
+					stage_names[stage]);
+			for(uint8_t i = 0; i < NUM_LATENCY_BUCKETS; i++) {
+				printf_P(PSTR(",%u"), histogram[source][stage][i]);
+			}
+			putchar('\n');
+		}
+	}
+}
+
+#endif /* LATENCY_ENABLED */
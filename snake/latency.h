@@ -0,0 +1,93 @@
+/*
+ * latency.h
+ *
+ * Written by Hans Song
+ *
+ * Measures how long it takes the game to respond to a direction input,
+ * from the moment the input arrives to
+ *	- the moment set_snake_dirn() is called for it (LATENCY_DIRN), and
+ *	- the moment the snake's head, having moved in that direction, has
+ *	  been sent to the LED matrix (LATENCY_DRAWN)
+ * for each input source. Button pushes and serial characters are
+ * timestamped in their interrupt handlers; the joystick is polled, so it
+ * is timestamped when the game loop sees it cross a threshold.
+ *
+ * Only the first input from a source that is still waiting to be dealt
+ * with is timestamped, so a direction key that arrives in a batch behind
+ * other characters is timed from the first of them. If the direction is
+ * changed again before the snake moves, only the later input is timed to
+ * the LED matrix.
+ *
+ * Latencies are counted in histograms with power of 2 millisecond
+ * buckets (under 1ms, under 2ms, ... under 512ms, 512ms or more), which
+ * are written to the terminal as comma separated L,... lines when 'l' is
+ * pressed.
+ *
+ * Like the event trace (see trace.h), this is only compiled in when
+ * LATENCY_ENABLED is defined; otherwise the macros below expand to
+ * nothing.
+ */
+
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+#include <stdint.h>
+
+/* Input sources */
+#define LATENCY_BUTTON		0
+#define LATENCY_SERIAL		1
+#define LATENCY_JOYSTICK	2
+#define NUM_LATENCY_SOURCES	3
+
+/* Points the latency is measured to */
+#define LATENCY_DIRN		0
+#define LATENCY_DRAWN		1
+#define NUM_LATENCY_STAGES	2
+
+#define NUM_LATENCY_BUCKETS	11
+
+#ifdef LATENCY_ENABLED
+
+/* Note that input has arrived from the source (unless earlier input from
+ * it is still waiting). Safe to call from an interrupt handler.
+ */
+void latency_mark(uint8_t source);
+
+/* Called before the waiting input from the source is read - the time it
+ * was marked is kept for latency_input() and the source is unmarked.
+ */
+void latency_take(uint8_t source);
+
+/* The snake direction has just been set from the input being handled,
+ * which was a button push (if button isn't -1), a serial escape sequence
+ * (if escape_char isn't -1) or otherwise the joystick.
+ */
+void latency_input(int8_t button, char escape_char);
+
+/* The snake has moved and its head has been drawn. */
+void latency_drawn(void);
+
+/* Forget any input being timed (at the start of a game). */
+void latency_reset(void);
+
+/* Write the histograms to the terminal. */
+void latency_dump(void);
+
+#define LATENCY_MARK(source) latency_mark(source)
+#define LATENCY_TAKE(source) latency_take(source)
+#define LATENCY_INPUT(button, escape_char) latency_input((button), (escape_char))
+#define LATENCY_DRAWN_HEAD() latency_drawn()
+#define LATENCY_RESET() latency_reset()
+
+#else
+
+#define LATENCY_MARK(source)
+#define LATENCY_TAKE(source)
+#define LATENCY_INPUT(button, escape_char)
+#define LATENCY_DRAWN_HEAD()
+#define LATENCY_RESET()
+#define latency_dump()
+
+#endif /* LATENCY_ENABLED */
+
+#endif /* LATENCY_H_ */
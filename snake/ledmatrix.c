@@ -21,6 +21,8 @@
 #define CMD_SHIFT_DISPLAY 0x04
 #define CMD_CLEAR_SCREEN 0x0F
 
+static uint8_t terminal_mirror = 1;
+
 void ledmatrix_setup(void) {
 	// Setup SPI - we divide the clock by 128.
 	// (This speed guarantees the SPI buffer will never overflow on
@@ -46,6 +48,9 @@ void ledmatrix_update_pixel(uint8_t x, uint8_t y, PixelColour pixel) {
 	(void)spi_send_byte( ((y & 0x07)<<4) | (x & 0x0F));
 	(void)spi_send_byte(pixel);
 	
+	if(!terminal_mirror) {
+		return;
+	}
 	if(pixel == COLOUR_RED) {
 		set_display_attribute(FG_RED);
 	} else if(pixel == COLOUR_GREEN) {
@@ -61,14 +66,18 @@ void ledmatrix_update_pixel(uint8_t x, uint8_t y, PixelColour pixel) {
 	}
 	char block = 219;
 	move_cursor(x+5, 6+(5-y));
-	printf("%c", block);
+	putchar(block);
 	
 	set_display_attribute(FG_WHITE);
 	move_cursor(50, 3);
-	printf("Score: %lu", get_score());
+	printf_P(PSTR("Score: %lu"), get_score());
 	//printf_P(PSTR("?"));
 }
 
+void ledmatrix_set_terminal_mirror(uint8_t on) {
+	terminal_mirror = on;
+}
+
 void ledmatrix_update_row(uint8_t y, MatrixRow row) {
 	if(y >= MATRIX_NUM_ROWS) {
 		// y value is too large - we ignore the request
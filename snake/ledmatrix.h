@@ -38,6 +38,11 @@ void ledmatrix_shift_display_left(void);
 void ledmatrix_shift_display_right(void);
 void ledmatrix_shift_display_up(void);
 void ledmatrix_shift_display_down(void);
+
+// Pixel updates are also drawn on the serial terminal (along with the
+// score) unless this is turned off, e.g. when the UART is being used for
+// binary telemetry instead.
+void ledmatrix_set_terminal_mirror(uint8_t on);
 void ledmatrix_clear(void);
 
 // Functions to operate on rows and columns
@@ -0,0 +1,322 @@
+/*
+ * mcts.c
+ *
+ * Written by Hans Song
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "mcts.h"
+#include "bitboard.h"
+#include "snake.h"
+#include "food.h"
+#include "rat.h"
+#include "superfood.h"
+#include "zobrist.h"
+#include "transposition.h"
+
+#ifndef MCTS_MAX_NODES
+#ifdef SRAM_DIET
+#define MCTS_MAX_NODES 16
+#else
+#define MCTS_MAX_NODES 32
+#endif
+#endif
+#ifndef MCTS_MAX_PLAYOUTS
+#define MCTS_MAX_PLAYOUTS 64
+#endif
+#define MCTS_MAX_DEPTH 8
+#define MCTS_ROLLOUT_DEPTH 12
+
+/* Rewards (out of 255) for a playout. Surviving matters most, then
+ * eating as much as possible.
+ */
+#define REWARD_SURVIVED 127
+#define REWARD_PER_ITEM 32
+
+#define SNAKE_POSITION_ARRAY_SIZE ((MAX_SNAKE_SIZE)+1)
+
+/* Cut down game state used for playouts. The snake is kept in a circular
+ * buffer as in snake.c, with its cells also in a bitboard so checking for
+ * collisions is quick. Food, super food and the rat are all just items
+ * to be eaten.
+ */
+typedef struct {
+	PosnType body[SNAKE_POSITION_ARRAY_SIZE];
+	uint8_t head;
+	uint8_t tail;
+	uint8_t length;
+	SnakeDirnType dirn;
+	Bitboard occupied;
+	Bitboard items;
+} SimState;
+
+/* Tree node. The children of a node are allocated next to each other
+ * starting at first_child.
+ */
+typedef struct {
+	uint16_t visits;
+	uint16_t reward;
+	uint8_t first_child;
+	uint8_t num_children;
+	uint8_t dirn;
+} MctsNode;
+
+static MctsNode nodes[MCTS_MAX_NODES];
+static uint8_t num_nodes;
+static SimState root_state;
+static uint16_t random_state;
+static uint8_t playouts;
+
+/* Random number generator for playouts (16 bit xorshift) */
+static uint16_t playout_random(void) {
+	random_state ^= random_state << 7;
+	random_state ^= random_state >> 9;
+	random_state ^= random_state << 8;
+	return random_state;
+}
+
+static void copy_game_state(SimState* state) {
+	uint8_t i;
+	state->length = get_snake_length();
+	for(i = 0; i < state->length; i++) {
+		state->body[i] = get_snake_position(i);
+	}
+	state->tail = 0;
+	state->head = state->length - 1;
+	state->dirn = get_snake_dirn();
+	get_snake_bitboard(state->occupied);
+	bitboard_clear(state->items);
+	for(i = 0; i < get_num_food_items(); i++) {
+		bitboard_set(state->items, get_position_of_food(i));
+	}
+	if(get_super_food_existence()) {
+		bitboard_set(state->items, get_super_food_pos());
+	}
+	bitboard_set(state->items, get_rat_pos());
+}
+
+/* Put a new item on a random free cell (as the game does when food is
+ * eaten).
+ */
+static void spawn_item(SimState* state) {
+	for(uint8_t attempts = 0; attempts < 16; attempts++) {
+		PosnType cell = position(playout_random() % BOARD_WIDTH,
+				playout_random() % BOARD_HEIGHT);
+		if(!bitboard_test(state->occupied, cell) &&
+				!bitboard_test(state->items, cell)) {
+			bitboard_set(state->items, cell);
+			return;
+		}
+	}
+}
+
+/* Return 1 if the snake can move in the given direction (i.e. it isn't
+ * reversing and won't hit itself - the tail will move out of the way).
+ */
+static uint8_t sim_can_move(const SimState* state, SnakeDirnType dirn) {
+	PosnType cell;
+	if(dirn == (state->dirn + 2) % 4) {
+		return 0;
+	}
+	cell = next_position(state->body[state->head], dirn);
+	return !bitboard_test(state->occupied, cell) || cell == state->body[state->tail];
+}
+
+/* Move the snake (which must be able to move in that direction). Returns
+ * 1 if it ate something, 0 otherwise.
+ */
+static uint8_t sim_move(SimState* state, SnakeDirnType dirn) {
+	PosnType cell = next_position(state->body[state->head], dirn);
+	uint8_t ate = bitboard_test(state->items, cell);
+	
+	state->dirn = dirn;
+	if(!ate || state->length >= MAX_SNAKE_SIZE) {
+		bitboard_reset(state->occupied, state->body[state->tail]);
+		if(++state->tail == SNAKE_POSITION_ARRAY_SIZE) {
+			state->tail = 0;
+		}
+	} else {
+		state->length++;
+	}
+	if(++state->head == SNAKE_POSITION_ARRAY_SIZE) {
+		state->head = 0;
+	}
+	state->body[state->head] = cell;
+	bitboard_set(state->occupied, cell);
+	if(ate) {
+		bitboard_reset(state->items, cell);
+		spawn_item(state);
+	}
+	return ate;
+}
+
+/* Reward for a playout in which the snake died (or survived) having
+ * eaten the given number of items.
+ */
+static uint8_t reward_for(uint8_t items_eaten, uint8_t survived) {
+	uint8_t reward = survived ? REWARD_SURVIVED : 0;
+	if(items_eaten > (255 - reward) / REWARD_PER_ITEM) {
+		items_eaten = (255 - reward) / REWARD_PER_ITEM;
+	}
+	return reward + items_eaten * REWARD_PER_ITEM;
+}
+
+/* Play random (but not suicidal) moves from the given state and return
+ * the reward.
+ */
+static uint8_t rollout(SimState* state, uint8_t items_eaten) {
+	SnakeDirnType moves[3];
+	uint8_t num_moves, dirn;
+	for(uint8_t depth = 0; depth < MCTS_ROLLOUT_DEPTH; depth++) {
+		num_moves = 0;
+		for(dirn = SNAKE_UP; dirn <= SNAKE_LEFT; dirn++) {
+			if(sim_can_move(state, dirn)) {
+				moves[num_moves++] = dirn;
+			}
+		}
+		if(num_moves == 0) {
+			return reward_for(items_eaten, 0);
+		}
+		items_eaten += sim_move(state, moves[playout_random() % num_moves]);
+	}
+	return reward_for(items_eaten, 1);
+}
+
+/* Add children to a node for each move that can be made, if there is
+ * room in the node array.
+ */
+static void expand(MctsNode* node, const SimState* state) {
+	node->first_child = num_nodes;
+	node->num_children = 0;
+	for(uint8_t dirn = SNAKE_UP; dirn <= SNAKE_LEFT; dirn++) {
+		if(num_nodes < MCTS_MAX_NODES && sim_can_move(state, dirn)) {
+			MctsNode* child = &nodes[num_nodes++];
+			child->visits = 0;
+			child->reward = 0;
+			child->num_children = 0;
+			child->first_child = 0;
+			child->dirn = dirn;
+			node->num_children++;
+		}
+	}
+}
+
+/* Choose the child to explore using the UCB1 formula. Unvisited children
+ * are always tried first.
+ */
+static uint8_t select_child(const MctsNode* node) {
+	uint8_t best = node->first_child;
+	float best_score = -1;
+	float log_visits = logf(node->visits);
+	for(uint8_t i = node->first_child; i < node->first_child + node->num_children; i++) {
+		float score;
+		if(nodes[i].visits == 0) {
+			return i;
+		}
+		score = nodes[i].reward / (255.0f * nodes[i].visits) +
+				1.4f * sqrtf(log_visits / nodes[i].visits);
+		if(score > best_score) {
+			best_score = score;
+			best = i;
+		}
+	}
+	return best;
+}
+
+/* Run one playout: walk down the tree, expand a leaf, play a random
+ * game from there and update the nodes along the way with the reward.
+ * Items appear in different places in different playouts, so the snake
+ * may have grown differently from when a node was added and its move
+ * may now run into the body. That ends the playout as a loss.
+ */
+static void playout(void) {
+	SimState state;
+	uint8_t path[MCTS_MAX_DEPTH + 1];
+	uint8_t depth = 0;
+	uint8_t items_eaten = 0;
+	uint8_t reward;
+	uint8_t dead = 0;
+	MctsNode* node = &nodes[0];
+	
+	memcpy(&state, &root_state, sizeof(SimState));
+	path[0] = 0;
+	while(node->num_children > 0 && depth < MCTS_MAX_DEPTH) {
+		path[++depth] = select_child(node);
+		node = &nodes[path[depth]];
+		if(!sim_can_move(&state, node->dirn)) {
+			dead = 1;
+			break;
+		}
+		items_eaten += sim_move(&state, node->dirn);
+		if(node->visits == 0) {
+			break;
+		}
+	}
+	if(!dead && node->visits > 0 && depth < MCTS_MAX_DEPTH) {
+		/* Leaf we have been to before - grow the tree */
+		expand(node, &state);
+		if(node->num_children > 0) {
+			path[++depth] = node->first_child;
+			node = &nodes[path[depth]];
+			items_eaten += sim_move(&state, node->dirn);
+		}
+	}
+	reward = dead ? reward_for(items_eaten, 0) : rollout(&state, items_eaten);
+	for(uint8_t i = 0; i <= depth; i++) {
+		nodes[path[i]].visits++;
+		nodes[path[i]].reward += reward;
+	}
+}
+
+SnakeDirnType mcts_dirn(void) {
+	uint64_t hash = get_zobrist_hash();
+	int16_t value;
+	uint8_t best, searched, move;
+	
+	/* The search only depends on the position, so if we have searched
+	 * this position before the answer is the same. (The move is checked
+	 * in case another position has the same hash.)
+	 */
+	if(probe_transposition_table(hash, &value, &searched, &move) &&
+			move != (get_snake_dirn() + 2) % 4) {
+		PosnType cell = next_position(get_snake_head_position(), move);
+		if(!is_snake_at(cell) || cell == get_snake_tail_position()) {
+			playouts = 0;
+			return move;
+		}
+	}
+	
+	copy_game_state(&root_state);
+	random_state = (uint16_t)hash | 1;
+	num_nodes = 1;
+	nodes[0].visits = 1;
+	nodes[0].reward = 0;
+	expand(&nodes[0], &root_state);
+	if(nodes[0].num_children == 0) {
+		/* No way out */
+		return get_snake_dirn();
+	}
+	
+	for(playouts = 0; playouts < MCTS_MAX_PLAYOUTS; playouts++) {
+		playout();
+	}
+	
+	/* Choose the most visited move */
+	best = nodes[0].first_child;
+	for(uint8_t i = best + 1; i < nodes[0].first_child + nodes[0].num_children; i++) {
+		if(nodes[i].visits > nodes[best].visits) {
+			best = i;
+		}
+	}
+	if(nodes[best].visits) {
+		store_transposition_table(hash, nodes[best].reward / nodes[best].visits,
+				playouts, nodes[best].dirn);
+	}
+	return nodes[best].dirn;
+}
+
+uint8_t get_mcts_playouts(void) {
+	return playouts;
+}
@@ -0,0 +1,39 @@
+/*
+ * mcts.h
+ *
+ * Written by Hans Song
+ *
+ * Monte Carlo tree search controller. Food spawning and the rat make the
+ * future uncertain, so rather than plan a path this controller plays out
+ * many possible futures from the current position and picks the move
+ * which did best on average. Each playout works on a cut down copy of the
+ * game state (snake, occupied cells and items) which is cheap to copy,
+ * and uses its own random number sequence (seeded from the position's
+ * hash) so the game's sequence is untouched and the controller's choices
+ * are repeatable.
+ *
+ * Tree nodes come from a fixed array which is reset each move, so no
+ * memory is allocated during the search. The search always runs
+ * MCTS_MAX_PLAYOUTS playouts (which can be set when building) - it is
+ * not cut short by the clock, since then the move chosen would depend on
+ * how long interrupts happened to take. If a search takes longer than the
+ * move delay the game slows down rather than the search; the game over
+ * screen shows the longest a move took. The move chosen is kept in the
+ * transposition table, so a position seen again isn't searched again.
+ */
+
+#ifndef MCTS_H_
+#define MCTS_H_
+
+#include <stdint.h>
+#include "snake.h"
+
+/* Return the direction the snake should move in next. */
+SnakeDirnType mcts_dirn(void);
+
+/* Number of playouts run for the last move (0 if the move was found in
+ * the transposition table - see transposition.h).
+ */
+uint8_t get_mcts_playouts(void);
+
+#endif /* MCTS_H_ */
@@ -0,0 +1,66 @@
+/*
+ * memory.c
+ *
+ * Written by Hans Song
+ */
+
+#include <stdio.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+#include "memory.h"
+
+/* Symbols provided by the linker - the start of .data, the end of .bss
+ * and the initial stack pointer (the top of RAM).
+ */
+extern uint8_t __data_start;
+extern uint8_t _end;
+extern uint8_t __stack;
+
+/* Paint the free RAM. This is placed in .init1 so it runs straight after
+ * reset, before the stack is used for anything. It must be naked (no
+ * prologue or epilogue) since it is not called, the startup code just
+ * falls through it. Written in assembler because r1 is not yet zeroed so
+ * compiled C can't be trusted here.
+ */
+void paint_stack(void) __attribute__((naked, used, section(".init1")));
+
+void paint_stack(void) {
+	__asm volatile (
+		"	ldi r30, lo8(_end)\n"
+		"	ldi r31, hi8(_end)\n"
+		"	ldi r24, %0\n"
+		"	ldi r25, hi8(__stack)\n"
+		"	rjmp 2f\n"
+		"1:	st Z+, r24\n"
+		"2:	cpi r30, lo8(__stack)\n"
+		"	cpc r31, r25\n"
+		"	brlo 1b\n"
+		"	breq 1b\n"
+		:: "M" (STACK_PAINT_BYTE));
+}
+
+uint16_t get_static_ram_size(void) {
+	return &_end - &__data_start;
+}
+
+uint16_t get_stack_headroom(void) {
+	const uint8_t* p = &_end;
+	uint16_t count = 0;
+	
+	while(p <= &__stack && *p == STACK_PAINT_BYTE) {
+		p++;
+		count++;
+	}
+	return count;
+}
+
+uint16_t get_stack_high_water(void) {
+	return (&__stack - &_end) + 1 - get_stack_headroom();
+}
+
+void print_memory_usage(void) {
+	printf_P(PSTR("RAM: %u static, stack up to %u, %u free"),
+			get_static_ram_size(), get_stack_high_water(),
+			get_stack_headroom());
+}
@@ -0,0 +1,40 @@
+/*
+ * memory.h
+ *
+ * Written by Hans Song
+ *
+ * Keeps an eye on how much of the 2KB of SRAM is in use. At reset (before
+ * the C runtime sets anything up) every byte between the end of the static
+ * variables (.data and .bss) and the top of RAM is painted with
+ * STACK_PAINT_BYTE. The stack grows down into this area, so counting how
+ * many painted bytes are left just above the static variables tells us how
+ * close the stack has ever come to running into them (the high water mark).
+ *
+ * The count can be fooled if the stack happens to write STACK_PAINT_BYTE
+ * itself at the deepest point, but will only ever be out by a few bytes.
+ */
+
+#ifndef MEMORY_H_
+#define MEMORY_H_
+
+#include <stdint.h>
+
+#define STACK_PAINT_BYTE 0xC5
+
+/* Number of bytes taken up by the static variables (.data and .bss). */
+uint16_t get_static_ram_size(void);
+
+/* Most bytes the stack has ever taken up since reset. */
+uint16_t get_stack_high_water(void);
+
+/* Number of bytes between the static variables and the deepest the stack
+ * has ever reached - i.e. how much RAM is still free.
+ */
+uint16_t get_stack_headroom(void);
+
+/* Write the three values above to the terminal at the current cursor
+ * position.
+ */
+void print_memory_usage(void);
+
+#endif /* MEMORY_H_ */
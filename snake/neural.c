@@ -0,0 +1,245 @@
+/*
+ * neural.c
+ *
+ * Written by Hans Song
+ */
+
+#include <string.h>
+#include <avr/eeprom.h>
+
+#include "neural.h"
+#include "bitboard.h"
+#include "snake.h"
+#include "food.h"
+#include "rat.h"
+#include "superfood.h"
+#include "game.h"
+
+#define FEATURES_PER_DIRN 3
+#define NEURAL_INPUTS (4 * FEATURES_PER_DIRN)
+#define NEURAL_HIDDEN 8
+
+/* Feature values run from 0 to FEATURE_MAX. Sums are scaled back down by
+ * FEATURE_SHIFT bits after each layer.
+ */
+#define FEATURE_MAX 64
+#define FEATURE_SHIFT 6
+
+/* Each weight is mutated with probability 1 in MUTATION_RATE */
+#define MUTATION_RATE 16
+
+/* Each generation the best score decays by 1/2^DECAY_SHIFT of itself */
+#define DECAY_SHIFT 3
+
+/* The best score and generation count change every game, so they are
+ * only written to the checkpoint every COUNTER_INTERVAL generations (an
+ * unattended tournament would otherwise wear out the EEPROM). The weights
+ * are written whenever a new network is kept - few bytes change each
+ * time.
+ */
+#define COUNTER_INTERVAL 16
+
+/* Weights of each layer. The last weight of each neuron is its bias. */
+typedef struct {
+	int8_t hidden[NEURAL_HIDDEN][NEURAL_INPUTS + 1];
+	int8_t output[4][NEURAL_HIDDEN + 1];
+} NeuralWeights;
+
+/* Checkpoint in EEPROM. The magic number changes if the layout does, so
+ * a stale checkpoint is ignored.
+ */
+#define CHECKPOINT_MAGIC 0xA5
+typedef struct {
+	uint8_t magic;
+	uint16_t generation;
+	uint32_t best_score;
+	NeuralWeights weights;
+} NeuralCheckpoint;
+
+static NeuralCheckpoint checkpoint EEMEM;
+
+/* Network being played this game, and the generation/best score so far */
+static NeuralWeights weights;
+static uint16_t generation;
+static uint32_t best_score;
+
+/* Whether generation and best_score have been read from the checkpoint */
+static uint8_t counters_loaded;
+
+static uint16_t mutation_random_state;
+
+/* Random number generator for mutations (16 bit xorshift). This is kept
+ * apart from the game's sequence so training doesn't change the games.
+ */
+static uint16_t mutation_random(void) {
+	mutation_random_state ^= mutation_random_state << 7;
+	mutation_random_state ^= mutation_random_state >> 9;
+	mutation_random_state ^= mutation_random_state << 8;
+	return mutation_random_state;
+}
+
+/* Starting network, used if there is no checkpoint. The first four hidden
+ * neurons favour directions with space and food, the other four detect
+ * a direction being blocked and veto it.
+ */
+static void default_weights(NeuralWeights* w) {
+	memset(w, 0, sizeof(NeuralWeights));
+	for(uint8_t dirn = 0; dirn < 4; dirn++) {
+		w->hidden[dirn][dirn * FEATURES_PER_DIRN + 1] = 32;
+		w->hidden[dirn][dirn * FEATURES_PER_DIRN + 2] = 48;
+		w->hidden[dirn + 4][dirn * FEATURES_PER_DIRN] = 64;
+		w->output[dirn][dirn] = 64;
+		w->output[dirn][dirn + 4] = -127;
+	}
+}
+
+static int8_t clamp_weight(int16_t value) {
+	if(value > INT8_MAX) {
+		return INT8_MAX;
+	} else if(value < -INT8_MAX) {
+		return -INT8_MAX;
+	}
+	return value;
+}
+
+void init_neural(void) {
+	int8_t* w = (int8_t*)&weights;
+	
+	/* The counters in the checkpoint may be behind the ones in RAM, so
+	 * they are only read after a reset.
+	 */
+	if(eeprom_read_byte(&checkpoint.magic) == CHECKPOINT_MAGIC) {
+		eeprom_read_block(&weights, &checkpoint.weights, sizeof(NeuralWeights));
+		if(!counters_loaded) {
+			generation = eeprom_read_word(&checkpoint.generation);
+			best_score = eeprom_read_dword(&checkpoint.best_score);
+		}
+	} else {
+		default_weights(&weights);
+		if(!counters_loaded) {
+			generation = 0;
+			best_score = 0;
+		}
+	}
+	counters_loaded = 1;
+	
+	/* Mutate. The first game of all plays the unmutated network so it
+	 * gets a score.
+	 */
+	if(generation > 0) {
+		mutation_random_state = (uint16_t)get_game_seed() ^ generation;
+		if(mutation_random_state == 0) {
+			mutation_random_state = 1;
+		}
+		for(uint16_t i = 0; i < sizeof(NeuralWeights); i++) {
+			if(mutation_random() % MUTATION_RATE == 0) {
+				/* Add a roughly normal step (sum of two uniform values) */
+				int16_t step = (int16_t)(mutation_random() % 17) +
+						(int16_t)(mutation_random() % 17) - 16;
+				w[i] = clamp_weight(w[i] + step);
+			}
+		}
+	}
+}
+
+/* Work out the inputs to the network for the current game state. */
+static void get_features(int8_t* features) {
+	Bitboard blocked, targets, region;
+	PosnType head = get_snake_head_position();
+	PosnType tail = get_snake_tail_position();
+	PosnType cell;
+	uint8_t distance;
+	
+	/* The tail moves out of the way as the snake moves */
+	get_snake_bitboard(blocked);
+	bitboard_reset(blocked, tail);
+	
+	bitboard_clear(targets);
+	for(int8_t i = 0; i < get_num_food_items(); i++) {
+		bitboard_set(targets, get_position_of_food(i));
+	}
+	if(get_super_food_existence()) {
+		bitboard_set(targets, get_super_food_pos());
+	}
+	bitboard_set(targets, get_rat_pos());
+	
+	for(uint8_t dirn = 0; dirn < 4; dirn++, features += FEATURES_PER_DIRN) {
+		cell = next_position(head, dirn);
+		if(bitboard_test(blocked, cell)) {
+			features[0] = FEATURE_MAX;
+			features[1] = 0;
+			features[2] = 0;
+			continue;
+		}
+		features[0] = 0;
+		/* Region size is at most 128 cells */
+		features[1] = bitboard_flood_fill(blocked, cell, region) / 2;
+		distance = bitboard_distance(blocked, cell, targets);
+		features[2] = (distance < FEATURE_MAX / 4) ? FEATURE_MAX - 4 * distance : 0;
+	}
+}
+
+/* Return the output of a neuron (clamped to 0 to FEATURE_MAX * 2 for
+ * hidden neurons).
+ */
+static int32_t neuron(const int8_t* w, const int8_t* inputs, uint8_t num_inputs) {
+	int32_t sum = (int32_t)w[num_inputs] * FEATURE_MAX;
+	for(uint8_t i = 0; i < num_inputs; i++) {
+		sum += (int16_t)w[i] * inputs[i];
+	}
+	return sum >> FEATURE_SHIFT;
+}
+
+SnakeDirnType neural_dirn(void) {
+	int8_t features[NEURAL_INPUTS];
+	int8_t hidden[NEURAL_HIDDEN];
+	SnakeDirnType reverse = (get_snake_dirn() + 2) % 4;
+	SnakeDirnType best = get_snake_dirn();
+	int32_t best_output = INT32_MIN;
+	int32_t value;
+	uint8_t i;
+	
+	get_features(features);
+	for(i = 0; i < NEURAL_HIDDEN; i++) {
+		value = neuron(weights.hidden[i], features, NEURAL_INPUTS);
+		/* ReLU, limited to fit in 8 bits */
+		hidden[i] = (value < 0) ? 0 : (value > INT8_MAX) ? INT8_MAX : value;
+	}
+	for(i = 0; i < 4; i++) {
+		if(i == reverse) {
+			continue;
+		}
+		value = neuron(weights.output[i], hidden, NEURAL_HIDDEN);
+		if(value > best_output) {
+			best_output = value;
+			best = i;
+		}
+	}
+	return best;
+}
+
+void neural_game_over(uint32_t score) {
+	best_score -= best_score >> DECAY_SHIFT;
+	generation++;
+	if(score >= best_score || generation == 1) {
+		/* Keep the new network. Only bytes which have changed are
+		 * written, to save wear on the EEPROM.
+		 */
+		best_score = score;
+		eeprom_update_block(&weights, &checkpoint.weights, sizeof(NeuralWeights));
+	}
+	if(generation % COUNTER_INTERVAL == 0 ||
+			eeprom_read_byte(&checkpoint.magic) != CHECKPOINT_MAGIC) {
+		eeprom_update_dword(&checkpoint.best_score, best_score);
+		eeprom_update_word(&checkpoint.generation, generation);
+		eeprom_update_byte(&checkpoint.magic, CHECKPOINT_MAGIC);
+	}
+}
+
+uint16_t get_neural_generation(void) {
+	return generation;
+}
+
+uint32_t get_neural_best_score(void) {
+	return best_score;
+}
@@ -0,0 +1,45 @@
+/*
+ * neural.h
+ *
+ * Written by Hans Song
+ *
+ * A small neural network controller which learns between games. For each
+ * of the four directions the network is given three features: whether
+ * moving that way hits the snake, how much free space can be reached
+ * from there and how close the nearest item is. These twelve inputs feed
+ * a hidden layer of NEURAL_HIDDEN neurons which gives a score for each
+ * direction, and the best scoring direction (other than reversing) is
+ * taken. Weights are 8 bit and sums are done with integers.
+ *
+ * The weights are evolved with a (1+1) evolution strategy, one game per
+ * generation: each game plays a randomly mutated copy of the best network
+ * so far, and the mutant replaces it if it scores at least as well. The
+ * best network is checkpointed in EEPROM (with its score and the
+ * generation count, which are only saved every few generations), so
+ * training carries on across resets. Scores vary a lot
+ * from game to game, so the recorded best score decays a little each
+ * generation to stop one lucky game locking in a network.
+ */
+
+#ifndef NEURAL_H_
+#define NEURAL_H_
+
+#include <stdint.h>
+#include "snake.h"
+
+/* Start a new game (generation) with a mutated copy of the best network. */
+void init_neural(void);
+
+/* Return the direction the snake should move in next. */
+SnakeDirnType neural_dirn(void);
+
+/* Finish the generation: keep the network if it scored well enough.
+ * Only called for games the network played from the start.
+ */
+void neural_game_over(uint32_t score);
+
+/* Number of generations so far and score of the best network. */
+uint16_t get_neural_generation(void);
+uint32_t get_neural_best_score(void);
+
+#endif /* NEURAL_H_ */
@@ -23,17 +23,44 @@
 #include "game.h"
 #include "snake.h"
 #include "rat.h"
+#include "replay.h"
+#include "controller.h"
+#include "mcts.h"
+#include "neural.h"
+#include "tournament.h"
+#include "exporter.h"
+#include "benchmark.h"
+#include "tickstats.h"
+#include "trace.h"
+#include "memory.h"
+#include "telemetry.h"
+#include "botlink.h"
+#include "input.h"
+#include "latency.h"
 
 
 // Define the CPU clock speed so we can use library delay functions
 #define F_CPU 8000000L
 #include <util/delay.h>
 
+#ifdef SIMAVR
+// Tell simavr (see tools/simavr) which processor and clock speed to
+// simulate
+#include <avr/avr_mcu_section.h>
+AVR_MCU(F_CPU, "atmega324a");
+#endif
+
 /* Variables for seven segment display */
 volatile uint8_t seven_seg_cc = 0;
 
+/* Number of moves the snake has made this game, whether this is a
+ * tournament game and, if so, whether it was ended at the step limit */
+static uint32_t snake_steps;
+static uint8_t tournament_game;
+static uint8_t reached_step_limit;
+
 /* Seven segment display segment values for 0 to 9 */
-uint8_t seven_seg_data[10] = {63,6,91,79,102,109,125,7,127,111};
+static const uint8_t seven_seg_data[10] PROGMEM = {63,6,91,79,102,109,125,7,127,111};
 
 /*
 ** Seven segment display runtime. Displays length of snake.
@@ -55,7 +82,7 @@ void seg_display(void) {
 ISR(TIMER1_COMPA_vect) {
 	if(get_snake_length() <= 9) {
 		PORTA = 0;
-		PORTC = seven_seg_data[get_snake_length()];
+		PORTC = pgm_read_byte(&seven_seg_data[get_snake_length()]);
 	} else {
 		/* Alternates showing digit */
 		seven_seg_cc = 1 ^ seven_seg_cc;
@@ -64,10 +91,10 @@ ISR(TIMER1_COMPA_vect) {
 		if((get_snake_length())/10 <= 9 && (get_snake_length())%10 <= 9) {
 			if(seven_seg_cc == 0) {
 				/* Display right digit*/
-				PORTC = seven_seg_data[get_snake_length()%10];
+				PORTC = pgm_read_byte(&seven_seg_data[get_snake_length()%10]);
 			} else {
 				/* Display left digit*/
-				PORTC = seven_seg_data[get_snake_length()/10];
+				PORTC = pgm_read_byte(&seven_seg_data[get_snake_length()/10]);
 			}
 		} else {
 			if(seven_seg_cc == 0) {
@@ -92,9 +119,6 @@ void handle_game_over(void);
 void handle_new_lap(void);
 void terminal_display(void);
 
-// ASCII code for Escape character
-#define ESCAPE_CHAR 27
-
 /////////////////////////////// main //////////////////////////////////
 int main(void) {
 	// Setup hardware and call backs. This will turn on 
@@ -130,8 +154,8 @@ void initialise_hardware(void) {
 	// Set up pin change interrupts on the push-buttons
 	init_button_interrupts();
 	
-	// Initialise joystick interrupts
-	//initADC();
+	// Set up the ADC for the joystick
+	init_joystick();
 	
 	// Setup serial port for 19200 baud communication with no echo
 	// of incoming characters
@@ -148,18 +172,18 @@ void terminal_display(void) {
 	char block = 219;
 	for(int8_t x = 4; x < (BOARD_WIDTH+6); x++) {
 		move_cursor(x, (BOARD_HEIGHT + 4));
-		printf("%c", block);
+		putchar(block);
 		
 		move_cursor(x, 3);
-		printf("%c", block);
+		putchar(block);
 		
 	}
 	for(int8_t y = 4; y < (BOARD_HEIGHT + 5); y++) {
 		move_cursor((BOARD_WIDTH + 5), y);
-		printf("%c", block);
+		putchar(block);
 		
 		move_cursor(4, y);
-		printf("%c", block);
+		putchar(block);
 	}
 }
 
@@ -185,7 +209,7 @@ void splash_screen(void) {
 	// Red message the first time through
 	PixelColour colour = COLOUR_RED;
 	while(1) {
-		set_scrolling_display_text("SNAKE 44374264", colour);
+		set_scrolling_display_text(PSTR("SNAKE 44374264"), colour);
 		// Scroll the message until it has scrolled off the 
 		// display or a button is pushed. We pause for 130ms between each scroll.
 		while(scroll_display()) {
@@ -210,8 +234,24 @@ void new_game(void) {
 	// Clear the serial terminal
 	clear_terminal();
 	
-	// Initialise the game and display
+	// Initialise the game and display. The seed comes from the clock
+	// so each game differs, but it is recorded and can be replayed.
+	// In tournament mode the seed (and controller) are chosen for us.
+	tournament_game = get_tournament_mode();
+	if(tournament_game) {
+		set_game_seed(tournament_next_game());
+	} else {
+		set_game_seed(get_clock_ticks());
+	}
+	snake_steps = 0;
+	reached_step_limit = 0;
+	replay_start(get_game_seed());
+	// Decide whether the board is drawn on the terminal before any of
+	// it is drawn
+	telemetry_prepare();
 	init_game();
+	init_controller();
+	TRACE(TRACE_GAME_START, get_controller());
 		
 	// Initialise the score
 	init_score();
@@ -219,25 +259,37 @@ void new_game(void) {
 	// Initialise seven segment display
 	seg_display();
 	
-	// Initialize joystick handler
-	init_joystick();
-	
 	// Reset move delay
 	init_move_delay();
 	
+	// Reset the per tick counters
+	init_tick_stats();
+	
+	// Send the starting board if binary telemetry is on
+	telemetry_start();
+	
 	terminal_display();
 	
 	// Delete any pending button pushes or serial input
 	empty_button_queue();
 	clear_serial_input_buffer();
+	reset_input();
+	LATENCY_RESET();
+	
+	// Let a bot know the game has started (now that we're ready for its
+	// moves)
+	bot_new_game();
 }
 
 void play_game(void) {
 	uint32_t last_move_time;
 	uint32_t last_rat_move;
+	uint32_t move_start_time, move_time;
 	int8_t button;
 	char serial_input, escape_sequence_char;
-	uint8_t characters_into_escape_sequence = 0;
+	InputEvent input_events[INPUT_MAX_EVENTS];
+	uint8_t num_events;
+	int8_t joystick_dirn, last_joystick_dirn = -1;
 	
 	// Record the last time the snake moved as the current time -
 	// this ensures we don't move the snake immediately.
@@ -252,113 +304,256 @@ void play_game(void) {
 		int16_t joystick_x = read_joystick(0);
 		int16_t joystick_y = read_joystick(1);
 		//printf("x: %u, y: %u\n", joystick_x, joystick_y);
-		// Check for input - which could be a button push or serial input.
-		// Serial input may be part of an escape sequence, e.g. ESC [ D
-		// is a left cursor key press. We will be processing each character
-		// independently and can't do anything until we get the third character.
-		// At most one of the following three variables will be set to a value 
-		// other than -1 if input is available.
-		// (We don't initalise button to -1 since button_pushed() will return -1
-		// if no button pushes are waiting to be returned.)
-		// Button pushes take priority over serial input. If there are both then
-		// we'll retrieve the serial input the next time through this loop
-		serial_input = -1;
-		escape_sequence_char = -1;
-		button = button_pushed();
-		if(button == -1) {
-			// No push button was pushed, see if there is any serial input
-			if(serial_input_available()) {
-				// Serial data was available - read the data from standard input
-				serial_input = fgetc(stdin);
-				// Check if the character is part of an escape sequence
-				if(characters_into_escape_sequence == 0 && serial_input == ESCAPE_CHAR) {
-					// We've hit the first character in an escape sequence (escape)
-					characters_into_escape_sequence++;
-					serial_input = -1; // Don't further process this character
-				} else if(characters_into_escape_sequence == 1 && serial_input == '[') {
-					// We've hit the second character in an escape sequence
-					characters_into_escape_sequence++;
-					serial_input = -1; // Don't further process this character
-				} else if(characters_into_escape_sequence == 2) {
-					// Third (and last) character in the escape sequence
-					escape_sequence_char = serial_input;
-					serial_input = -1;  // Don't further process this character - we
-										// deal with it as part of the escape sequence
-					characters_into_escape_sequence = 0;
-				} else {
-					// Character was not part of an escape sequence (or we received
-					// an invalid second character in the sequence). We'll process 
-					// the data in the serial_input variable.
-					characters_into_escape_sequence = 0;
-				}
+		// Check for input - which could be button pushes or serial input.
+		// Everything that has arrived over the serial port is decoded into
+		// key presses and escape sequences (e.g. ESC [ D is a left cursor
+		// key press) - see input.h. We deal with the events in order; if
+		// there are none we still go through once so the joystick is
+		// handled.
+		num_events = get_input_events(input_events);
+		
+		// The joystick is recorded for the replay whenever the direction
+		// it is held in changes.
+		if(joystick_x <= 200) {
+			joystick_dirn = SNAKE_RIGHT;
+		} else if(joystick_y >= 800) {
+			joystick_dirn = SNAKE_UP;
+		} else if(joystick_x >= 800) {
+			joystick_dirn = SNAKE_LEFT;
+		} else if(joystick_y <= 200) {
+			joystick_dirn = SNAKE_DOWN;
+		} else {
+			joystick_dirn = -1;
+		}
+		if(joystick_dirn != last_joystick_dirn) {
+			replay_record_arg(REPLAY_EVENT_JOYSTICK, joystick_dirn);
+			last_joystick_dirn = joystick_dirn;
+			if(joystick_dirn != -1) {
+				// The joystick has no interrupt, so it is timed from here
+				LATENCY_MARK(LATENCY_JOYSTICK);
+				LATENCY_TAKE(LATENCY_JOYSTICK);
 			}
 		}
 		
-		// Process the input. 
-		if(button==0 || escape_sequence_char=='C' || joystick_x <= 200) {
-			// Set next direction to be moved to be right.
-			set_snake_dirn(SNAKE_RIGHT);
-		} else  if (button==2 || escape_sequence_char == 'A' || joystick_y >= 800) {
-			// Set next direction to be moved to be up
-			set_snake_dirn(SNAKE_UP);
-		} else if(button==3 || escape_sequence_char=='D' || joystick_x >= 800) {
-			// Set next direction to be moved to be left
-			set_snake_dirn(SNAKE_LEFT);
-		} else if (button==1 || escape_sequence_char == 'B' || joystick_y <= 200) {
-			// Set next direction to be moved to be down
-			set_snake_dirn(SNAKE_DOWN);
-		} else if(serial_input == 'p' || serial_input == 'P') {
-			// Unimplemented feature - pause/unpause the game until 'p' or 'P' is
-			while ((serial_input = fgetc(stdin))) {
-				//move_cursor(3,3);
-				//printf("game paused");
-				// safeguard to clear any unwanted button presses
-				empty_button_queue();
-				if (serial_input == 'p' || serial_input == 'P') {
-					//move_cursor(3,3);
-					//printf("           ");
-					break;
-				} else if (serial_input == 'n' || serial_input == 'N') {
-					reset_game();
+		for(uint8_t i = 0; i == 0 || i < num_events; i++) {
+			button = -1;
+			serial_input = -1;
+			escape_sequence_char = -1;
+			if(i < num_events) {
+				if(input_events[i].type == INPUT_BUTTON) {
+					button = input_events[i].value;
+				} else if(input_events[i].type == INPUT_ESCAPE) {
+					escape_sequence_char = input_events[i].value;
+				} else {
+					serial_input = input_events[i].value;
 				}
 			}
-		} else if(serial_input == 'n' || serial_input == 'N') {
-			reset_game();
-		} 
-		// else - invalid input or we're part way through an escape sequence -
-		// do nothing		
+			
+			// Record the input for the replay.
+			if(button != -1) {
+				replay_record(REPLAY_EVENT_BUTTON + button);
+			} else if(escape_sequence_char != (char)-1) {
+				replay_record_arg(REPLAY_EVENT_ESCAPE, escape_sequence_char);
+			} else if(serial_input != (char)-1) {
+				replay_record_arg(REPLAY_EVENT_KEY, serial_input);
+			}
+			
+			// Process the input. 
+			if(button==0 || escape_sequence_char=='C' || joystick_x <= 200) {
+				// Set next direction to be moved to be right.
+				set_snake_dirn(SNAKE_RIGHT);
+				LATENCY_INPUT(button, escape_sequence_char);
+			} else  if (button==2 || escape_sequence_char == 'A' || joystick_y >= 800) {
+				// Set next direction to be moved to be up
+				set_snake_dirn(SNAKE_UP);
+				LATENCY_INPUT(button, escape_sequence_char);
+			} else if(button==3 || escape_sequence_char=='D' || joystick_x >= 800) {
+				// Set next direction to be moved to be left
+				set_snake_dirn(SNAKE_LEFT);
+				LATENCY_INPUT(button, escape_sequence_char);
+			} else if (button==1 || escape_sequence_char == 'B' || joystick_y <= 200) {
+				// Set next direction to be moved to be down
+				set_snake_dirn(SNAKE_DOWN);
+				LATENCY_INPUT(button, escape_sequence_char);
+			} else if(serial_input == 'p' || serial_input == 'P') {
+				// Unimplemented feature - pause/unpause the game until 'p' or 'P' is
+				while (1) {
+					// Wait for a key. Bot commands are still taken (and a
+					// zero byte in one no longer unpauses the game).
+					while(!serial_input_available()) {
+						; // wait
+					}
+					serial_input = serial_read_byte();
+					if(bot_parse_byte(serial_input)) {
+						continue;
+					}
+					replay_record_arg(REPLAY_EVENT_KEY, serial_input);
+					//move_cursor(3,3);
+					//printf("game paused");
+					// safeguard to clear any unwanted button presses
+					empty_button_queue();
+					if (serial_input == 'p' || serial_input == 'P') {
+						//move_cursor(3,3);
+						//printf("           ");
+						break;
+					} else if (serial_input == 'n' || serial_input == 'N') {
+						reset_game();
+					}
+				}
+			} else if(serial_input == 'n' || serial_input == 'N') {
+				reset_game();
+			} else if(serial_input == 'a' || serial_input == 'A') {
+				// Toggle the autopilot
+				toggle_controller(CONTROLLER_AUTOPILOT);
+			} else if(serial_input == 'h' || serial_input == 'H') {
+				// Toggle the Hamiltonian cycle controller
+				toggle_controller(CONTROLLER_HAMILTONIAN);
+			} else if(serial_input == 'm' || serial_input == 'M') {
+				// Toggle the Monte Carlo tree search controller
+				toggle_controller(CONTROLLER_MCTS);
+			} else if(serial_input == 'e' || serial_input == 'E') {
+				// Toggle the evolved neural network controller
+				toggle_controller(CONTROLLER_NEURAL);
+			} else if(serial_input == 't' || serial_input == 'T') {
+				// Toggle tournament mode - takes effect from the next game
+				toggle_tournament_mode();
+			} else if(serial_input == 'x' || serial_input == 'X') {
+				// Toggle exporting of training data
+				toggle_export();
+			} else if(serial_input == 'b' || serial_input == 'B') {
+				// Run the benchmarks, then start a new game since they
+				// leave the game in a mess
+				run_benchmarks();
+				reset_game();
+			} else if(serial_input == 'c' || serial_input == 'C') {
+				// Show the per tick counters, how much RAM is left and
+				// what the serial port has lost or been held up by
+				print_tick_stats();
+				move_cursor(30, 11);
+				print_memory_usage();
+				move_cursor(30, 12);
+				printf_P(PSTR("Serial: %u lost, %u overrun, %u/%u stalls in/out, "
+						"%u timed out"),
+						get_serial_input_overruns(), get_serial_uart_overruns(),
+						get_serial_input_stalls(), get_serial_output_stalls(),
+						get_input_timeouts());
+			} else if(serial_input == 'd' || serial_input == 'D') {
+				// Dump the event trace (if tracing is compiled in)
+				trace_dump();
+			} else if(serial_input == 'l' || serial_input == 'L') {
+				// Write out the input latency histograms (if compiled in)
+				latency_dump();
+			} else if(serial_input == 'v' || serial_input == 'V') {
+				// Toggle binary telemetry in place of the terminal view -
+				// takes effect from the next game
+				toggle_telemetry();
+			} 
+			// else - invalid input - do nothing
+		}
 		
-		if(get_clock_ticks() >= last_rat_move + 1000) {
+		// (In a bot's lockstep mode the rat moves with the snake instead)
+		if(!bot_lockstep() && get_clock_ticks() >= last_rat_move + 1000) {
+			replay_record(REPLAY_EVENT_RAT_STEP);
 			move_rat();
 			last_rat_move = get_clock_ticks();
 		}
 		
-		// Check for timer related events here
-		if(get_clock_ticks() >= last_move_time + get_move_delay()) {
+		// Check for timer related events here (or, in a bot's lockstep mode,
+		// whether the bot has sent its next move)
+		if(bot_lockstep() ? bot_move_ready() :
+				get_clock_ticks() >= last_move_time + get_move_delay()) {
 			// move_delay seconds has passed since the last time we moved the snake (default 600),
 			// so move it now
+			move_start_time = get_clock_micros();
+			bot_before_move();
+			controller_before_move();
+			replay_record(REPLAY_EVENT_SNAKE_STEP);
+			export_before_move();
 			if(!attempt_to_move_snake_forward()) {
 				// Move attempt failed - game over
+				export_after_move(0);
+				bot_after_move(0);
 				break;
 			}
+			export_after_move(1);
+			bot_after_move(1);
+			move_time = get_clock_micros() - move_start_time;
+			add_tick_count(TICK_MOVE_TIME, (move_time > UINT16_MAX) ? UINT16_MAX : move_time);
+			end_tick();
+			snake_steps++;
+			if(bot_rat_step_due()) {
+				replay_record(REPLAY_EVENT_RAT_STEP);
+				move_rat();
+			}
 			last_move_time = get_clock_ticks();
+			
+			// A tournament game has to end even if the controller never
+			// dies - it counts as survived
+			if(tournament_game && snake_steps >= TOURNAMENT_MAX_STEPS) {
+				reached_step_limit = 1;
+				break;
+			}
 		}
+		
+		// Stream out any recorded replay and training data if the UART
+		// has room
+		replay_poll();
+		export_poll();
 	}
 	// If we get here the game is over. 
 }
 
 void handle_game_over() {
+	replay_end();
+	telemetry_end();
+	TRACE(TRACE_GAME_OVER, get_snake_length());
+	trace_dump();
+	controller_game_over();
+	tournament_record_game(get_controller(), get_score(), get_snake_length(),
+			snake_steps, reached_step_limit);
 	move_cursor(10,14);
 	// Print a message to the terminal. 
 	printf_P(PSTR("GAME OVER"));
 	move_cursor(10,15);
 	printf_P(PSTR("Press a button to start again"));
+	if(get_controller() != CONTROLLER_HUMAN) {
+		move_cursor(10,16);
+		printf_P(PSTR("Controller took up to %u us per move"),
+				get_controller_max_time());
+		if(get_controller() == CONTROLLER_MCTS) {
+			move_cursor(10,17);
+			printf_P(PSTR("(%u playouts for the last move)"), get_mcts_playouts());
+		} else if(get_controller() == CONTROLLER_NEURAL) {
+			move_cursor(10,17);
+			printf_P(PSTR("Generation %u, best score %lu"),
+					get_neural_generation(), get_neural_best_score());
+		}
+	}
+	if(get_export_enabled() && get_export_dropped()) {
+		move_cursor(10,18);
+		printf_P(PSTR("%u training records dropped"), get_export_dropped());
+	}
+	move_cursor(10,19);
+	print_memory_usage();
+	if(get_tournament_mode()) {
+		// Report the result and go straight on to the next game
+		print_tournament_result(get_controller(), get_score(),
+				get_snake_length(), snake_steps, reached_step_limit);
+		return;
+	}
 	while(button_pushed() == -1) {
-		char serial_input = fgetc(stdin);
+		// Wait until a button has been pushed or 'n' typed. Bot commands
+		// are still taken (so a byte of one can't start a new game).
+		if(!serial_input_available()) {
+			continue;
+		}
+		char serial_input = serial_read_byte();
+		if(bot_parse_byte(serial_input)) {
+			continue;
+		}
 		if (serial_input == 'n' || serial_input == 'N') {
 			reset_game();
 		}
-		; // wait until a button has been pushed
 	}
 	
 }
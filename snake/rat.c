@@ -15,6 +15,8 @@
 #include "snake.h"
 #include "board.h"
 #include "timer0.h"
+#include "game.h"
+#include "zobrist.h"
 
 #define LEFT 0
 #define RIGHT 1
@@ -29,12 +31,11 @@ PosnType add_rat(void) {
 	x = 0;
 	y = 0;
 	attempts = 0;
-	srandom(get_clock_ticks());
 	do {
 		// Generate a new position - this is based on a sequence rather
 		// then being random
-        x = random()%BOARD_WIDTH;
-        y = random()%BOARD_HEIGHT;
+        x = game_random()%BOARD_WIDTH;
+        y = game_random()%BOARD_HEIGHT;
 		test_position = position(x,y);
         attempts++;
     } while(attempts < 100 && 
@@ -47,7 +48,9 @@ PosnType add_rat(void) {
         */
         return INVALID_POSITION;
     }
+	zobrist_toggle(ZOBRIST_RAT, rat_pos);
 	rat_pos = test_position;
+	zobrist_toggle(ZOBRIST_RAT, rat_pos);
 	return rat_pos;
 }
 
@@ -56,7 +59,9 @@ PosnType get_rat_pos(void) {
 }
 
 void set_rat_pos(PosnType pos) {
+	zobrist_toggle(ZOBRIST_RAT, rat_pos);
 	rat_pos = pos;
+	zobrist_toggle(ZOBRIST_RAT, rat_pos);
 }
 
 PosnType next_rat_pos(void) {
@@ -66,9 +71,9 @@ PosnType next_rat_pos(void) {
 	do {
 		new_x_pos = x_position(rat_pos);
 		new_y_pos = y_position(rat_pos);
-		int8_t dirn = random()%4;
+		int8_t dirn = game_random()%4;
 		if(dirn == LEFT) {
-			if(new_x_pos == 1) {
+			if(new_x_pos == 0) {
 				new_x_pos++;
 			} else {
 				new_x_pos--;
@@ -86,7 +91,7 @@ PosnType next_rat_pos(void) {
 				new_y_pos++;
 			}
 		} else if(dirn == DOWN) {
-			if(new_y_pos == 1) {
+			if(new_y_pos == 0) {
 				new_y_pos++;
 				} else {
 				new_y_pos--;
@@ -103,15 +108,14 @@ PosnType next_rat_pos(void) {
         */
         return INVALID_POSITION;
     }
+	zobrist_toggle(ZOBRIST_RAT, rat_pos);
 	rat_pos = newPos;
+	zobrist_toggle(ZOBRIST_RAT, rat_pos);
 	return rat_pos;
 }
 
 int8_t position_out_of_bounds(PosnType pos) {
-	if (x_position(pos) >= BOARD_WIDTH - 1 &&
-		x_position(pos) <= 2 &&
-		y_position(pos) >= BOARD_HEIGHT - 1 &&
-		y_position(pos) <= 2) {
+	if (x_position(pos) >= BOARD_WIDTH || y_position(pos) >= BOARD_HEIGHT) {
 		return 1;
 	} else {
 		return 0;
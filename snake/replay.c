@@ -0,0 +1,212 @@
+/*
+ * replay.c
+ *
+ * Written by Hans Song
+ *
+ * See replay.h for the record format.
+ */
+
+#include <stdio.h>
+#include <avr/pgmspace.h>
+
+#include "replay.h"
+#include "serialio.h"
+#include "timer0.h"
+#include "game.h"
+#include "snake.h"
+#include "food.h"
+#include "rat.h"
+#include "superfood.h"
+#include "score.h"
+
+/* Buffer of encoded records waiting to be streamed out. We try to
+ * stream once REPLAY_FLUSH_THRESHOLD bytes are waiting, and are forced
+ * to (blocking on the UART if need be) if the buffer fills.
+ */
+#define REPLAY_BUFFER_SIZE 32
+#define REPLAY_FLUSH_THRESHOLD 16
+static uint8_t replay_buffer[REPLAY_BUFFER_SIZE];
+static uint8_t replay_length;
+
+/* Clock tick of the previous record (records hold the difference) and
+ * whether a game is currently being recorded.
+ */
+static uint32_t last_event_time;
+static uint8_t recording;
+
+/* Keyframes are due every REPLAY_KEYFRAME_INTERVAL snake steps, and are
+ * written regardless of the room in the UART once they are
+ * REPLAY_KEYFRAME_SLACK steps overdue. REPLAY_KEYFRAME_MAX_LENGTH is the
+ * largest possible keyframe (in bytes, excluding the record header).
+ */
+#define REPLAY_KEYFRAME_INTERVAL 32
+#define REPLAY_KEYFRAME_SLACK 16
+#define REPLAY_KEYFRAME_MAX_LENGTH (1 + (MAX_SNAKE_SIZE) + 3 + (MAX_FOOD) + 2 + 10)
+static uint8_t steps_since_keyframe;
+
+static const char hex_digits[16] PROGMEM = "0123456789ABCDEF";
+
+/* Number of characters a flush of n buffered bytes sends: ESC _ R,
+ * two hex digits per byte, then ESC \
+ */
+#define FLUSH_LENGTH(n) (2 * (n) + 5)
+
+static void replay_put_hex(uint8_t byte) {
+	putchar(pgm_read_byte(&hex_digits[byte >> 4]));
+	putchar(pgm_read_byte(&hex_digits[byte & 0x0F]));
+}
+
+static void replay_put_hex_value(uint32_t value, uint8_t num_bytes) {
+	while(num_bytes--) {
+		replay_put_hex(value & 0xFF);
+		value >>= 8;
+	}
+}
+
+/* Open a chunk and write out the buffered bytes. The caller may add
+ * further bytes with replay_put_hex() before closing the chunk.
+ */
+static void replay_open_chunk(void) {
+	putchar('\x1b');
+	putchar('_');
+	putchar('R');
+	for(uint8_t i = 0; i < replay_length; i++) {
+		replay_put_hex(replay_buffer[i]);
+	}
+	replay_length = 0;
+}
+
+static void replay_close_chunk(void) {
+	putchar('\x1b');
+	putchar('\\');
+}
+
+static void replay_flush(void) {
+	if(replay_length == 0) {
+		return;
+	}
+	replay_open_chunk();
+	replay_close_chunk();
+}
+
+static void replay_put_byte(uint8_t byte) {
+	if(replay_length >= REPLAY_BUFFER_SIZE) {
+		replay_flush();
+	}
+	replay_buffer[replay_length++] = byte;
+}
+
+/* Write the time since the last record as a varint followed by the
+ * event code.
+ */
+static void replay_put_header(uint8_t event) {
+	uint32_t now = get_clock_ticks();
+	uint32_t delta = now - last_event_time;
+	last_event_time = now;
+	while(delta >= 0x80) {
+		replay_put_byte((delta & 0x7F) | 0x80);
+		delta >>= 7;
+	}
+	replay_put_byte(delta);
+	replay_put_byte(event);
+}
+
+void replay_start(uint32_t seed) {
+	if(recording) {
+		replay_end();
+	}
+	recording = 1;
+	replay_length = 0;
+	steps_since_keyframe = 0;
+	last_event_time = get_clock_ticks();
+	replay_put_header(REPLAY_EVENT_SEED);
+	for(uint8_t i = 0; i < 4; i++) {
+		replay_put_byte(seed & 0xFF);
+		seed >>= 8;
+	}
+}
+
+void replay_record(uint8_t event) {
+	if(recording) {
+		replay_put_header(event);
+		if(event == REPLAY_EVENT_SNAKE_STEP) {
+			steps_since_keyframe++;
+		}
+	}
+}
+
+void replay_record_arg(uint8_t event, uint8_t arg) {
+	if(recording) {
+		replay_put_header(event);
+		replay_put_byte(arg);
+	}
+}
+
+/* Write a keyframe record if there is room for it (and anything buffered)
+ * in the UART output buffer, or regardless (blocking until the UART has
+ * sent enough) if force is set. The keyframe is written straight out
+ * rather than through our (much smaller) buffer. The output buffer of an
+ * SRAM_DIET build is too small to ever hold a whole keyframe, so it is
+ * also written (blocking part way through) once the output buffer has
+ * emptied. Returns 1 if written.
+ */
+static uint8_t replay_keyframe(uint8_t force) {
+	uint8_t i, length;
+	PosnType super_food_pos = INVALID_POSITION;
+	
+	/* Allow for a record header of up to 6 bytes */
+	if(!force && serial_output_space() <
+			FLUSH_LENGTH(replay_length + 6 + REPLAY_KEYFRAME_MAX_LENGTH) &&
+			!serial_output_empty()) {
+		return 0;
+	}
+	replay_put_header(REPLAY_EVENT_KEYFRAME);
+	replay_open_chunk();
+	
+	length = get_snake_length();
+	replay_put_hex(length);
+	for(i = 0; i < length; i++) {
+		replay_put_hex(get_snake_position(i));
+	}
+	replay_put_hex(get_snake_dirn());
+	replay_put_hex(get_next_snake_dirn());
+	
+	length = get_num_food_items();
+	replay_put_hex(length);
+	for(i = 0; i < length; i++) {
+		replay_put_hex(get_position_of_food(i));
+	}
+	
+	replay_put_hex(get_rat_pos());
+	if(get_super_food_existence()) {
+		super_food_pos = get_super_food_pos();
+	}
+	replay_put_hex(super_food_pos);
+	replay_put_hex_value(get_score(), 4);
+	replay_put_hex_value(get_move_delay(), 2);
+	replay_put_hex_value(get_game_random_state(), 4);
+	replay_close_chunk();
+	return 1;
+}
+
+void replay_poll(void) {
+	if(!recording) {
+		return;
+	}
+	if(steps_since_keyframe >= REPLAY_KEYFRAME_INTERVAL &&
+			replay_keyframe(steps_since_keyframe >=
+			REPLAY_KEYFRAME_INTERVAL + REPLAY_KEYFRAME_SLACK)) {
+		steps_since_keyframe = 0;
+	} else if(replay_length >= REPLAY_FLUSH_THRESHOLD &&
+			serial_output_space() >= FLUSH_LENGTH(replay_length)) {
+		replay_flush();
+	}
+}
+
+void replay_end(void) {
+	if(recording) {
+		replay_put_header(REPLAY_EVENT_END);
+		replay_flush();
+		recording = 0;
+	}
+}
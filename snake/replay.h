@@ -0,0 +1,93 @@
+/*
+ * replay.h
+ *
+ * Written by Hans Song
+ *
+ * Records each game as its seed plus the ordered stream of everything
+ * that advances it: inputs (button pushes, escape sequences, other keys,
+ * joystick directions, controller choices, moves queued by a bot and the
+ * direction a built in controller chose for each move) and timed events
+ * (snake steps, rat steps, super food appearing or expiring). Since the
+ * random number generator is only seeded once per game (see
+ * set_game_seed()), replaying these events in order against the same seed
+ * reproduces the game exactly. A reader takes a built in controller's
+ * moves from the record rather than running the controller again, since
+ * a controller's choices can depend on more than the game (the neural
+ * network controller's weights are kept in EEPROM and change from game to
+ * game).
+ *
+ * Each record is a varint (7 bits per byte, least significant group first,
+ * top bit set on all but the last byte) holding the number of milliseconds
+ * since the previous record, followed by an event code byte and, for some
+ * codes, argument bytes (see below).
+ *
+ * Records are buffered in a small RAM buffer and streamed out over the
+ * UART as hex inside ANSI "application program command" strings
+ * (ESC _ R <hex> ESC \). Terminals ignore these, so the normal terminal
+ * view is not disturbed, while a host capturing the serial output can
+ * extract the replay. Output only happens when the UART output buffer has
+ * room for the whole chunk, so recording never blocks gameplay unless
+ * the replay buffer itself fills.
+ *
+ * Every REPLAY_KEYFRAME_INTERVAL snake steps a keyframe record holding the
+ * full game state is also written, so a reader can start from the nearest
+ * keyframe rather than re-simulating a game from the start. After the
+ * event code a keyframe holds:
+ *		snake length L, then L positions from tail to head
+ *		snake direction and the direction it will move in next, which
+ *		differs if a turn is waiting (both SnakeDirnType)
+ *		number of food items F, then F food positions
+ *		rat position
+ *		super food position (INVALID_POSITION if there is none)
+ *		score (4 bytes), move delay (2 bytes) and random sequence
+ *		state (4 bytes), each least significant byte first
+ * A keyframe is normally only written when the UART output buffer can
+ * take it whole (or, if it never could, when the buffer is empty);
+ * otherwise it is tried again each time replay_poll() is called. If it is
+ * still waiting REPLAY_KEYFRAME_SLACK snake steps later it is written
+ * anyway, blocking the game until the UART has sent enough of it, so
+ * keyframes are never more than REPLAY_KEYFRAME_INTERVAL +
+ * REPLAY_KEYFRAME_SLACK (48) snake steps apart. In an SRAM_DIET build the
+ * output buffer is smaller than a keyframe, so writing one always blocks
+ * for part of it.
+ */
+
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include <stdint.h>
+
+/* Event codes. Codes marked (+1) are followed by a single argument byte. */
+#define REPLAY_EVENT_BUTTON		0x00	/* 0x00 to 0x03 - button 0 to 3 pushed */
+#define REPLAY_EVENT_ESCAPE		0x04	/* (+1) final character of escape sequence */
+#define REPLAY_EVENT_KEY		0x05	/* (+1) other serial character */
+#define REPLAY_EVENT_CONTROLLER	0x06	/* (+1) controller chosen */
+#define REPLAY_EVENT_SEED		0x07	/* (+4) game seed, least significant byte first */
+#define REPLAY_EVENT_JOYSTICK	0x08	/* (+1) joystick direction (SnakeDirnType, 0xFF centred) */
+#define REPLAY_EVENT_BOT		0x09	/* (+1) direction of a move queued by a bot (see botlink.h) */
+#define REPLAY_EVENT_CONTROLLER_MOVE 0x0A	/* (+1) direction chosen by a built in controller */
+#define REPLAY_EVENT_SNAKE_STEP	0x10	/* snake moved forward (or tried to) */
+#define REPLAY_EVENT_RAT_STEP	0x11	/* rat moved */
+#define REPLAY_EVENT_SUPER_FOOD	0x12	/* super food added or removed */
+#define REPLAY_EVENT_KEYFRAME	0x18	/* full game state - see above */
+#define REPLAY_EVENT_END		0x1F	/* end of game */
+
+/* Start recording a new game with the given seed. If a previous
+ * recording is still open it is ended first.
+ */
+void replay_start(uint32_t seed);
+
+/* Record an event without/with an argument byte. */
+void replay_record(uint8_t event);
+void replay_record_arg(uint8_t event, uint8_t arg);
+
+/* Stream out buffered records (and a keyframe if one is due) if there is
+ * room in the UART output buffer. Should be called regularly from the game
+ * loop, between moves, so that keyframes see a consistent game state.
+ */
+void replay_poll(void);
+
+/* Record the end of the game and flush everything recorded. */
+void replay_end(void);
+
+#endif /* REPLAY_H_ */
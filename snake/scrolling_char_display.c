@@ -113,23 +113,22 @@ static PixelColour colour = COLOUR_RED;
  */
 static volatile const uint8_t* next_col_ptr = 0;
 
-/* String to be displayed. 
+/* String (in program memory) to be displayed. 
  * next_char_to_display will be used to point to the next
  * character from this string to be displayed.
  */
-static char* display_string;
+static PGM_P display_string;
 
-static volatile char* next_char_to_display = 0;
+static PGM_P volatile next_char_to_display = 0;
 
 /*
  * Set the message to be displayed - we just copy the 
- * pointer not the string it points to, so it is important
- * that the original string not change after this function
- * is called while the string is still being displayed.
+ * pointer not the string it points to, which must be in
+ * program memory.
  * We reset the pointers to ensure the next column to be displayed
  * comes from the first character of this string.
  */
-void set_scrolling_display_text(char* string_to_display, PixelColour c) {
+void set_scrolling_display_text(PGM_P string_to_display, PixelColour c) {
 	colour = c;
 	display_string = string_to_display;
 	next_col_ptr = 0;
@@ -184,7 +183,7 @@ uint8_t scroll_display(void) {
 		 * (next_char_to_display) so that it points to the character 
 		 * after.
 		 */
-		next_char = *(next_char_to_display++);
+		next_char = pgm_read_byte(next_char_to_display++);
 		if(next_char == 0) {
 			/* We reached the null character at the end of the string.
 			 * There is no next character, reset our pointer to 
@@ -8,6 +8,7 @@
 #define SCROLLING_CHAR_DISPLAY_H_
 
 #include <stdint.h>
+#include <avr/pgmspace.h>
 #include "pixel_colour.h"
 
 /* Sets the text to be displayed and the colour it will be
@@ -15,12 +16,10 @@
  * so will overwrite/interfere with any currently scrolling
  * message. To avoid this, wait until the scroll_display()
  * function below has returned 0 to indicate the message scrolling
- * is complete. Note that this string is not 
- * copied, so it is important that this string not change
- * after this function is called while the string is still
- * being displayed.
+ * is complete. The string must be in program memory (e.g. use
+ * PSTR("...")) so that it doesn't take up any RAM.
  */
-void set_scrolling_display_text(char* string, PixelColour colour);
+void set_scrolling_display_text(PGM_P string, PixelColour colour);
 
 /* Scroll the display. Should be called whenever the display
  * is to be scrolled one pixel to the left. It is recommended that
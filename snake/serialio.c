@@ -17,6 +17,8 @@
  * input is sought, then this will block forever.
  * The function input_available() can be used to test whether there is
  * input available to read from stdin.
+ * Input can optionally be flow controlled (see serialio.h) so that a
+ * sender can't overrun the input buffer.
  *
  */
 
@@ -28,6 +30,11 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
 
+#include "timer0.h"
+#include "tickstats.h"
+#include "trace.h"
+#include "latency.h"
+
 /* System clock rate in Hz. (L at the end indicates this is a long constant) */
 #define SYSCLK 8000000L
 
@@ -42,20 +49,77 @@
  * to the beginning (assuming those bytes have been output).
  * NOTE - OUTPUT_BUFFER_SIZE can not be larger than 255 without changing
  * the type of the variables below (currently defined as 8 bit unsigned ints).
+ * Both buffer sizes can be set from the compiler command line; an SRAM_DIET
+ * build uses much smaller buffers by default (output will block more often).
  */
+#ifndef OUTPUT_BUFFER_SIZE
+#ifdef SRAM_DIET
+#define OUTPUT_BUFFER_SIZE 128
+#else
 #define OUTPUT_BUFFER_SIZE 255
+#endif
+#endif
 volatile char out_buffer[OUTPUT_BUFFER_SIZE];
 volatile uint8_t out_insert_pos;
 volatile uint8_t bytes_in_out_buffer;
 
 /* Circular buffer to hold incoming characters. Works on same principle
- * as output buffer
+ * as output buffer. Characters are stored as received (a carriage
+ * return is only turned into a linefeed when read through stdio).
  */
-#define INPUT_BUFFER_SIZE 16
+#ifndef INPUT_BUFFER_SIZE
+#ifdef SRAM_DIET
+#define INPUT_BUFFER_SIZE 24
+#else
+#define INPUT_BUFFER_SIZE 32
+#endif
+#endif
 volatile char input_buffer[INPUT_BUFFER_SIZE];
 volatile uint8_t input_insert_pos;
 volatile uint8_t bytes_in_input_buffer;
-volatile uint8_t input_overrun;
+
+/* Flow control watermarks - the sender is asked to stop once the input
+ * buffer holds INPUT_HIGH_WATER characters and to carry on once it is
+ * down to INPUT_LOW_WATER. The room left above the high watermark
+ * (INPUT_HEADROOM) must cover what the sender transmits before it reacts
+ * (a PC serial port may send its whole transmit FIFO, often 16 bytes).
+ */
+#ifndef INPUT_HEADROOM
+#define INPUT_HEADROOM 16
+#endif
+#ifndef INPUT_HIGH_WATER
+#define INPUT_HIGH_WATER (INPUT_BUFFER_SIZE - INPUT_HEADROOM)
+#endif
+#ifndef INPUT_LOW_WATER
+#define INPUT_LOW_WATER (INPUT_HIGH_WATER / 2)
+#endif
+#if (defined(SERIAL_FLOW_XONXOFF) || defined(SERIAL_FLOW_RTSCTS)) && \
+		(INPUT_HIGH_WATER <= 0 || \
+		INPUT_HIGH_WATER > INPUT_BUFFER_SIZE - INPUT_HEADROOM)
+#error "INPUT_BUFFER_SIZE is too small for INPUT_HEADROOM (or INPUT_HIGH_WATER is too high)"
+#endif
+
+/* Flow control characters */
+#define XON 0x11
+#define XOFF 0x13
+
+/* Flow control state: whether we have asked the sender to stop, a flow
+ * control character waiting to be sent ahead of the output buffer (0 if
+ * none) and whether output is being held back by the other end (CTS).
+ */
+static volatile uint8_t input_stopped;
+static volatile uint8_t flow_char;
+static volatile uint8_t output_held;
+
+/* Counters - characters thrown away because the input buffer was full,
+ * characters lost because the UART itself overran (the receive interrupt
+ * was held off for too long), and the number of times input and output
+ * were stalled by flow control.
+ */
+static volatile uint16_t input_overruns;
+static volatile uint16_t uart_overruns;
+static volatile uint16_t input_stalls;
+static volatile uint16_t output_stalls;
 
 /* Variable to keep track of whether incoming characters are to be echoed
  * back or not.
@@ -83,7 +147,9 @@ void init_serial_stdio(long baudrate, int8_t echo) {
 	bytes_in_out_buffer = 0;
 	input_insert_pos = 0;
 	bytes_in_input_buffer = 0;
-	input_overrun = 0;
+	input_stopped = 0;
+	flow_char = 0;
+	output_held = 0;
 	
 	/*
 	 * Record whether we're going to echo characters or not
@@ -111,6 +177,19 @@ void init_serial_stdio(long baudrate, int8_t echo) {
 	 * Enable receive complete interrupt 
 	*/
 	UCSR0B  |= (1 <<RXCIE0);
+	
+#ifdef SERIAL_FLOW_RTSCTS
+	/* RTS is an output, low when we are ready to receive. CTS is an input
+	 * (pulled up so a missing connection holds nothing back), low when
+	 * we may send. We get a pin change interrupt on CTS.
+	 */
+	DDRD |= (1<<SERIAL_RTS_PIN);
+	PORTD &= ~(1<<SERIAL_RTS_PIN);
+	DDRD &= ~(1<<SERIAL_CTS_PIN);
+	PORTD |= (1<<SERIAL_CTS_PIN);
+	PCMSK3 |= (1<<SERIAL_CTS_PIN);
+	PCICR |= (1<<PCIE3);
+#endif
 
 	/* Set up our stream so the put and get functions below are used 
 	 * to write/read characters via the serial port when we use
@@ -120,27 +199,127 @@ void init_serial_stdio(long baudrate, int8_t echo) {
 	stdin = &myStream;
 }
 
+/* Ask the sender to stop or carry on. Called with interrupts off. */
+static void stop_input(void) {
+	input_stopped = 1;
+	input_stalls++;
+#if defined(SERIAL_FLOW_XONXOFF)
+	flow_char = XOFF;
+	UCSR0B |= (1 << UDRIE0);
+#elif defined(SERIAL_FLOW_RTSCTS)
+	PORTD |= (1<<SERIAL_RTS_PIN);
+#endif
+}
+
+static void resume_input(void) {
+	input_stopped = 0;
+#if defined(SERIAL_FLOW_XONXOFF)
+	flow_char = XON;
+	UCSR0B |= (1 << UDRIE0);
+#elif defined(SERIAL_FLOW_RTSCTS)
+	PORTD &= ~(1<<SERIAL_RTS_PIN);
+#endif
+}
+
 int8_t serial_input_available(void) {
 	return (bytes_in_input_buffer != 0);
 }
 
 void clear_serial_input_buffer(void) {
 	/* Just adjust our buffer data so it looks empty */
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
 	input_insert_pos = 0;
 	bytes_in_input_buffer = 0;
+	if(input_stopped) {
+		resume_input();
+	}
+	if(interrupts_enabled) {
+		sei();
+	}
 }
 
-static int uart_put_char(char c, FILE* stream) {
-	uint8_t interrupts_enabled;
+/* Remove the oldest character from the input buffer - there must be
+ * one.
+ */
+static char remove_input_char(void) {
+	/*
+	 * Turn interrupts off and remove a character from the input
+	 * buffer. We reenable interrupts if they were on.
+	 * The pending character is the one which is byte_in_input_buffer
+	 * characters before the insert position (taking into account
+	 * that we may need to wrap around).
+	 */
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	char c;
+	if(input_insert_pos - bytes_in_input_buffer < 0) {
+		/* Need to wrap around */
+		c = input_buffer[input_insert_pos - bytes_in_input_buffer
+				+ INPUT_BUFFER_SIZE];
+	} else {
+		c = input_buffer[input_insert_pos - bytes_in_input_buffer];
+	}
 	
+	/* Decrement our count of bytes in the input buffer, and let the
+	 * sender carry on if it was stopped and there is now plenty of room
+	 */
+	bytes_in_input_buffer--;
+	if(input_stopped && bytes_in_input_buffer <= INPUT_LOW_WATER) {
+		resume_input();
+	}
+	if(interrupts_enabled) {
+		sei();
+	}	
+	return c;
+}
+
+int16_t serial_read_byte(void) {
+	if(bytes_in_input_buffer == 0) {
+		return -1;
+	}
+	return (uint8_t)remove_input_char();
+}
+
+uint16_t get_serial_input_overruns(void) {
+	return input_overruns;
+}
+
+uint16_t get_serial_uart_overruns(void) {
+	return uart_overruns;
+}
+
+uint16_t get_serial_input_stalls(void) {
+	return input_stalls;
+}
+
+uint16_t get_serial_output_stalls(void) {
+	return output_stalls;
+}
+
+uint8_t serial_output_space(void) {
+	return OUTPUT_BUFFER_SIZE - bytes_in_out_buffer;
+}
+
+int8_t serial_output_empty(void) {
+	return (bytes_in_out_buffer == 0);
+}
+
+static int uart_put_char(char c, FILE* stream) {
 	/* Add the character to the buffer for transmission (if there 
 	 * is space to do so). If not we wait until the buffer has space.
 	 * If the character is \n, we output \r (carriage return)
 	 * also.
 	*/
 	if(c == '\n') {
-		uart_put_char('\r', stream);
+		serial_write_byte('\r');
 	}
+	return serial_write_byte(c);
+}
+
+int8_t serial_write_byte(uint8_t c) {
+	uint8_t interrupts_enabled;
+	uint32_t wait_start;
 	
 	/* If the buffer is full and interrupts are disabled then we
 	 * abort - we don't output the character since the buffer will
@@ -150,12 +329,17 @@ static int uart_put_char(char c, FILE* stream) {
 	 * ISR which extracts bytes from the buffer.
 	*/
 	interrupts_enabled = bit_is_set(SREG, SREG_I);
-	while(bytes_in_out_buffer >= OUTPUT_BUFFER_SIZE) {
+	if(bytes_in_out_buffer >= OUTPUT_BUFFER_SIZE) {
 		if(!interrupts_enabled) {
 			return 1;
-		}		
-		/* else do nothing */
+		}
+		wait_start = get_clock_micros();
+		while(bytes_in_out_buffer >= OUTPUT_BUFFER_SIZE) {
+			/* do nothing */
+		}
+		add_tick_count(TICK_UART_WAIT, get_clock_micros() - wait_start);
 	}
+	add_tick_count(TICK_UART_BYTES, 1);
 	
 	/* Add the character to the buffer for transmission if there
 	 * is space to do so. We advance the insert_pos to the next
@@ -189,29 +373,13 @@ int uart_get_char(FILE* stream) {
 		/* do nothing */
 	}
 	
-	/*
-	 * Turn interrupts off and remove a character from the input
-	 * buffer. We reenable interrupts if they were on.
-	 * The pending character is the one which is byte_in_input_buffer
-	 * characters before the insert position (taking into account
-	 * that we may need to wrap around).
+	/* If the character is a carriage return, turn it into a
+	 * linefeed 
 	 */
-	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
-	cli();
-	char c;
-	if(input_insert_pos - bytes_in_input_buffer < 0) {
-		/* Need to wrap around */
-		c = input_buffer[input_insert_pos - bytes_in_input_buffer
-				+ INPUT_BUFFER_SIZE];
-	} else {
-		c = input_buffer[input_insert_pos - bytes_in_input_buffer];
+	char c = remove_input_char();
+	if (c == '\r') {
+		c = '\n';
 	}
-	
-	/* Decrement our count of bytes in the input buffer */
-	bytes_in_input_buffer--;
-	if(interrupts_enabled) {
-		sei();
-	}	
 	return c;
 }
 
@@ -221,6 +389,25 @@ int uart_get_char(FILE* stream) {
  */
 ISR(USART0_UDRE_vect) 
 {
+	/* A flow control character goes out ahead of everything else */
+	if(flow_char) {
+		UDR0 = flow_char;
+		flow_char = 0;
+		return;
+	}
+#ifdef SERIAL_FLOW_RTSCTS
+	/* If the other end has asked us to stop, wait for the CTS pin change
+	 * interrupt to start us again.
+	 */
+	if(bit_is_set(PIND, SERIAL_CTS_PIN)) {
+		if(!output_held) {
+			output_held = 1;
+			output_stalls++;
+		}
+		UCSR0B &= ~(1<<UDRIE0);
+		return;
+	}
+#endif
 	/* Check if we have data in our buffer */
 	if(bytes_in_out_buffer > 0) {
 		/* Yes we do - remove the pending byte and output it
@@ -263,8 +450,13 @@ ISR(USART0_UDRE_vect)
 
 ISR(USART0_RX_vect) 
 {
-	/* Read the character - we ignore the possibility of overrun. */
+	/* Read the character, counting any characters the UART had to drop
+	 * because we didn't get here in time.
+	 */
 	char c;
+	if(bit_is_set(UCSR0A, DOR0)) {
+		uart_overruns++;
+	}
 	c = UDR0;
 		
 	if(do_echo && bytes_in_out_buffer < OUTPUT_BUFFER_SIZE) {
@@ -277,20 +469,15 @@ ISR(USART0_RX_vect)
 	}
 	
 	/* 
-	 * Check if we have space in our buffer. If not, set the overrun
-	 * flag and throw away the character. (We never clear the 
-	 * overrun flag - it's up to the programmer to check/clear
-	 * this flag if desired.)
+	 * Check if we have space in our buffer. If not, count the overrun
+	 * and throw away the character.
 	 */
 	if(bytes_in_input_buffer >= INPUT_BUFFER_SIZE) {
-		input_overrun = 1;
+		input_overruns++;
+		TRACE(TRACE_SERIAL_LOST, c);
 	} else {
-		/* If the character is a carriage return, turn it into a
-		 * linefeed 
-		*/
-		if (c == '\r') {
-			c = '\n';
-		}
+		TRACE(TRACE_SERIAL_RX, c);
+		LATENCY_MARK(LATENCY_SERIAL);
 		
 		/* 
 		 * There is room in the input buffer 
@@ -301,16 +488,34 @@ ISR(USART0_RX_vect)
 			/* Wrap around buffer pointer if necessary */
 			input_insert_pos = 0;
 		}
+#if defined(SERIAL_FLOW_XONXOFF) || defined(SERIAL_FLOW_RTSCTS)
+		/* Ask the sender to stop if the buffer is getting full */
+		if(!input_stopped && bytes_in_input_buffer >= INPUT_HIGH_WATER) {
+			stop_input();
+		}
+#endif
 	}
 }
 
-void init_joystick(void) {	
-	/* Set up the serial port for stdin communication at 19200 baud, no echo */
-	init_serial_stdio(19200,0);
-	
-	/* Turn on global interrupts */
-	sei();
-	
+#ifdef SERIAL_FLOW_RTSCTS
+/*
+ * CTS pin change - if output was held back and the other end is ready
+ * again, restart it.
+ */
+ISR(PCINT3_vect)
+{
+	if(output_held && bit_is_clear(PIND, SERIAL_CTS_PIN)) {
+		output_held = 0;
+		UCSR0B |= (1<<UDRIE0);
+	}
+}
+#endif
+
+void init_joystick(void) {
+	/* Only the ADC - the serial port is set up once, by
+	 * init_serial_stdio(). Setting it up again would throw away anything
+	 * still waiting to be sent.
+	 */
 	ADCSRA = (1<<ADEN)|(1<<ADPS2)|(1<<ADPS1);
 }
 
@@ -322,11 +527,13 @@ int16_t read_joystick(int8_t dirn) {
 		ADMUX |= 0b01000100;
 	}
 	// Start the ADC conversion
+	uint32_t wait_start = get_clock_micros();
 	ADCSRA |= (1<<ADSC);
 	
 	while(ADCSRA & (1<<ADSC)) {
 		; /* Wait until conversion finished */
 	}
+	add_tick_count(TICK_ADC_WAIT, get_clock_micros() - wait_start);
 	uint16_t value = ADC; // read the value
 	return value;
 }
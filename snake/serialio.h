@@ -11,6 +11,19 @@
  * output by the UART as speed permits.) Interrupts must be enabled 
  * globally for this module to work (after init_serial_stdio() is called).
  *
+ * Input can be flow controlled so a sender can't overrun the input buffer
+ * by defining one of these when building:
+ *	SERIAL_FLOW_XONXOFF - XOFF is sent when the input buffer is filling
+ *		up and XON once it has emptied out. Output is not flow controlled
+ *		and XON/XOFF characters received are not treated specially. Only
+ *		use this with text output - a host that obeys XON/XOFF will trip
+ *		over those bytes in binary output (telemetry and bot replies).
+ *	SERIAL_FLOW_RTSCTS - the same using an RTS output (high to stop the
+ *		sender) on pin SERIAL_RTS_PIN of port D. Output is held back while
+ *		the CTS input (SERIAL_CTS_PIN of port D) is high.
+ * The sizes of the buffers and the flow control watermarks can also be
+ * set when building (see serialio.c).
+ *
  */
 
 #ifndef SERIALIO_H_
@@ -24,6 +37,16 @@
 #define UP 3
 #define DOWN 4
 
+/* Port D pins used for hardware flow control (PD4 and PD5 are unused by
+ * the rest of the project)
+ */
+#ifndef SERIAL_RTS_PIN
+#define SERIAL_RTS_PIN 4
+#endif
+#ifndef SERIAL_CTS_PIN
+#define SERIAL_CTS_PIN 5
+#endif
+
 
 /* Initialise serial IO using the UART. baudrate specifies the desired
  * baudrate (e.g. 19200) and echo determines whether incoming characters
@@ -43,6 +66,39 @@ int8_t serial_input_available(void);
  */
 void clear_serial_input_buffer(void);
 
+/* Read a character from the serial port without waiting and exactly as
+ * received (stdio turns \r into \n) - for binary data. Returns -1 if
+ * there is no input waiting.
+ */
+int16_t serial_read_byte(void);
+
+/* Counts of characters lost because the input buffer was full and
+ * because the UART overran (the receive interrupt ran late), and of the
+ * number of times input and output were stopped by flow control.
+ */
+uint16_t get_serial_input_overruns(void);
+uint16_t get_serial_uart_overruns(void);
+uint16_t get_serial_input_stalls(void);
+uint16_t get_serial_output_stalls(void);
+
+/* Return the number of characters that can be written to the output
+ * buffer without blocking.
+ */
+uint8_t serial_output_space(void);
+
+/* Return non-zero if everything written so far has been sent (or is being
+ * sent) by the UART.
+ */
+int8_t serial_output_empty(void);
+
+/* Write a byte to the serial port exactly as given (unlike putchar(), a
+ * \n is not expanded to \r\n) - for binary data. Waits if the output
+ * buffer is full. Returns 0 on success, 1 if the byte was dropped
+ * because the buffer is full and interrupts are disabled.
+ */
+int8_t serial_write_byte(uint8_t c);
+
+/* Set up the ADC for reading the joystick. */
 void init_joystick(void);
 
 int16_t read_joystick(int8_t dirn);
@@ -8,6 +8,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <avr/pgmspace.h>
 
 #include "position.h"
 #include "snake.h"
@@ -19,6 +20,9 @@
 #include "terminalio.h"
 #include "score.h"
 #include "timer0.h"
+#include "game.h"
+#include "zobrist.h"
+#include "trace.h"
 
 #define SNAKE_POSITION_ARRAY_SIZE ((MAX_SNAKE_SIZE)+1)
 
@@ -84,9 +88,8 @@ void init_snake(void) {
 	** be stored at indexes 0 and 1 in the array. Snake 
 	** is initially moving to the right.
 	*/
-	srandom(get_clock_ticks());
-	uint8_t x_pos = random()%(BOARD_WIDTH - 3);
-	uint8_t y_pos = random()%(BOARD_HEIGHT - 2);
+	uint8_t x_pos = game_random()%(BOARD_WIDTH - 3);
+	uint8_t y_pos = game_random()%(BOARD_HEIGHT - 2);
 	snakeLength = 2;
 	snakeTailIndex = 0;
 	snakeHeadIndex = 1;
@@ -120,6 +123,82 @@ uint8_t get_snake_length(void) {
 	return snakeLength;
 }
 
+/* get_snake_position(index)
+**
+** Returns the position index elements on from the tail, wrapping
+** around the end of the array if required.
+*/
+PosnType get_snake_position(uint8_t index) {
+	index += snakeTailIndex;
+	if(index >= SNAKE_POSITION_ARRAY_SIZE) {
+		index -= SNAKE_POSITION_ARRAY_SIZE;
+	}
+	return snakePositions[index];
+}
+
+/* get_snake_dirn()
+**
+** Returns the current direction of the snake.
+*/
+SnakeDirnType get_snake_dirn(void) {
+	return curSnakeDirn;
+}
+
+/* get_next_snake_dirn()
+**
+** Returns the direction the snake will move in next.
+*/
+SnakeDirnType get_next_snake_dirn(void) {
+	return nextSnakeDirn;
+}
+
+/* get_snake_segment_dirn(index)
+**
+** Returns the direction the snake moved in to get from the given part of
+** the snake to the next one.
+*/
+SnakeDirnType get_snake_segment_dirn(uint8_t index) {
+	PosnType from = get_snake_position(index);
+	PosnType to = get_snake_position(index + 1);
+	uint8_t dirn;
+	
+	for(dirn = SNAKE_UP; dirn < SNAKE_LEFT; dirn++) {
+		if(next_position(from, dirn) == to) {
+			break;
+		}
+	}
+	return dirn;
+}
+
+/* next_position(posn, dirn)
+**
+** Returns the position one step from posn in direction dirn. If we're at
+** the edge of the board, then we wrap around to the other edge. (The wrap
+** goes to BOARD_WIDTH - 1 or BOARD_HEIGHT - 1 itself rather than relying
+** on position() to mask an out of range coordinate, which only works
+** when the board is 16 by 8.)
+*/
+PosnType next_position(PosnType posn, SnakeDirnType dirn) {
+	uint8_t x = x_position(posn);
+	uint8_t y = y_position(posn);
+	
+	switch(dirn) {
+		case SNAKE_LEFT:
+			x = (x == 0) ? BOARD_WIDTH - 1 : x - 1;
+			break;
+		case SNAKE_UP:
+			y = (y == BOARD_HEIGHT - 1) ? 0 : y + 1;
+			break;
+		case SNAKE_DOWN:
+			y = (y == 0) ? BOARD_HEIGHT - 1 : y - 1;
+			break;
+		case SNAKE_RIGHT:
+			x = (x == BOARD_WIDTH - 1) ? 0 : x + 1;
+			break;
+	}
+	return position(x, y);
+}
+
 /* advance_snake_head()
 **
 ** ` to move snake head forward. Returns
@@ -135,8 +214,6 @@ uint8_t get_snake_length(void) {
 ** (Only the last three of these result in the head position being moved.)
 */
 int8_t advance_snake_head(void) {
-	int8_t headX;	/* head X position */
-	int8_t headY;	/* head Y position */
 	PosnType newHeadPosn;
 	
 	/* Check the snake isn't already too long */
@@ -144,58 +221,16 @@ int8_t advance_snake_head(void) {
 		return SNAKE_LENGTH_ERROR;
 	}
     
-	/* Current head position */
-	headX = x_position(snakePositions[snakeHeadIndex]);
-	headY = y_position(snakePositions[snakeHeadIndex]);
-    
     /* Work out where the new head position should be - we
-    ** move 1 position in our NEXT direction of movement if we can.
-	** If we're at the edge of the board, then we wrap around to
-	** the other edge.
+    ** move 1 position in our NEXT direction of movement.
     */
-    switch (nextSnakeDirn) {
-        case SNAKE_LEFT:
-			if(headX == 1) {
-				// Snake head is already at the left hand edge of the board
-				// - wrap around to right hand side
-				headX = BOARD_WIDTH;
-			} else {
-				headX -= 1;
-			}
-			break;
-		
-		case SNAKE_UP:
-			if(headY == BOARD_HEIGHT - 1) {
-				// Head is already at the top of the board - wrap around
-				headY = 0;
-			} else {
-				headY += 1;
-			}
-        break;
-		
-		case SNAKE_DOWN:
-			if(headY == 1) {
-				// Head is already at the bottom of the board - wrap around
-				headY = BOARD_HEIGHT;
-			} else {
-				headY -= 1;
-			}
-		break;
-		
-		case SNAKE_RIGHT:
-			if(headX == BOARD_WIDTH - 1) {
-				// Snake head is already at the right hand edge of the board
-				// - wrap around to left hand side
-				headX = 0;
-			} else {
-				headX += 1;
-			}
-		break;
-    }
-
-	newHeadPosn = position(headX, headY);
+	newHeadPosn = next_position(snakePositions[snakeHeadIndex], nextSnakeDirn);
 
 	/* Update the current direction */
+	if(curSnakeDirn != nextSnakeDirn) {
+		zobrist_toggle_dirn(curSnakeDirn);
+		zobrist_toggle_dirn(nextSnakeDirn);
+	}
 	curSnakeDirn = nextSnakeDirn;
 
 	/* ADD CODE HERE to check whether the new head position
@@ -204,9 +239,10 @@ int8_t advance_snake_head(void) {
 	** which can help you.
 	*/
 	if (is_snake_at(newHeadPosn) && newHeadPosn != get_snake_tail_position()) {
+		TRACE(TRACE_COLLISION, newHeadPosn);
 		clear_terminal();
 		move_cursor(3,3);
-		printf("collision detected\n");
+		printf_P(PSTR("collision detected\n"));
 		return COLLISION;
 	}
 
@@ -215,8 +251,12 @@ int8_t advance_snake_head(void) {
     ** Advance head by 1. First work out the index
 	** of the new head position in the array of snake positions.
 	** and whether this has wrapped around in our array of positions
-	** or not. Update the length.
+	** or not. Update the length. The old head becomes part of the body.
     */
+	zobrist_toggle(ZOBRIST_SNAKE_HEAD, snakePositions[snakeHeadIndex]);
+	/* A body cell is hashed with the direction the snake left it in */
+	zobrist_toggle(ZOBRIST_SNAKE_BODY + curSnakeDirn, snakePositions[snakeHeadIndex]);
+	zobrist_toggle(ZOBRIST_SNAKE_HEAD, newHeadPosn);
 	snakeHeadIndex++;
 	if(snakeHeadIndex == SNAKE_POSITION_ARRAY_SIZE) {
 		/* Array has wrapped around */
@@ -246,7 +286,7 @@ int8_t advance_snake_head(void) {
 				return ATE_FOOD;
 			}
 			move_cursor(60,5);
-			printf("score: %4lu\n", get_score());
+			printf_P(PSTR("score: %4lu\n"), get_score());
 			//showLength();
 		} else {
 			return ATE_FOOD_BUT_CANT_GROW;
@@ -272,6 +312,7 @@ int8_t advance_snake_head(void) {
 PosnType advance_snake_tail(void) {
 	// Get the current tail position
 	PosnType prev_tail_position = snakePositions[snakeTailIndex];
+	zobrist_toggle(ZOBRIST_SNAKE_BODY + get_snake_segment_dirn(0), prev_tail_position);
 	
 	/* Update the tail index */
 	snakeTailIndex++;
@@ -307,6 +348,7 @@ void set_snake_dirn(SnakeDirnType dirn) {
     } else {
 		nextSnakeDirn = curSnakeDirn;
 	}
+	TRACE(TRACE_DIRN, nextSnakeDirn);
 }
 
 /* is_snake_at
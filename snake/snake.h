@@ -59,6 +59,42 @@ PosnType get_snake_tail_position(void);
 */
 uint8_t get_snake_length(void);
 
+/* get_snake_position(index)
+**
+** Returns the position of the given part of the snake, counting from
+** the tail (index 0) to the head (index get_snake_length()-1).
+** (index must be less than the snake's length.)
+*/
+PosnType get_snake_position(uint8_t index);
+
+/* get_snake_dirn()
+**
+** Returns the direction the snake last moved in.
+*/
+SnakeDirnType get_snake_dirn(void);
+
+/* get_next_snake_dirn()
+**
+** Returns the direction the snake will move in next (as set by
+** set_snake_dirn()).
+*/
+SnakeDirnType get_next_snake_dirn(void);
+
+/* get_snake_segment_dirn(index)
+**
+** Returns the direction from the given part of the snake (counting from
+** the tail as for get_snake_position()) to the next part towards the head.
+** (index must be less than the snake's length minus one.)
+*/
+SnakeDirnType get_snake_segment_dirn(uint8_t index);
+
+/* next_position(posn, dirn)
+**
+** Returns the position the snake's head would move to from posn if
+** moving in direction dirn (wrapping around the edges of the board).
+*/
+PosnType next_position(PosnType posn, SnakeDirnType dirn);
+
 /* advance_snake_head()
 **
 ** Attempt to advance the snake's head by one in the 
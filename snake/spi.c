@@ -6,6 +6,8 @@
 
 #include <avr/io.h>
 #include "spi.h"
+#include "timer0.h"
+#include "tickstats.h"
 
 void spi_setup_master(uint8_t clockdivider) {
 	// Set up SPI communication as a master
@@ -61,9 +63,18 @@ uint8_t spi_send_byte(uint8_t byte) {
 	// complete. (The final read of SPSR0 followed by a read of SPDR0
 	// will cause the SPIF0 bit to be reset to 0. See page 224 of the 
 	// ATmega324A datasheet - 10/2016 version.)
+#ifdef SPI_STATS_ENABLED
+	// Counting costs more than sending a byte, so it is only done when
+	// asked for (see tickstats.h)
+	uint32_t wait_start = get_clock_micros();
+#endif
 	SPDR0 = byte;
 	while((SPSR0 & (1<<SPIF0)) == 0) {
 		; // wait
 	}
+#ifdef SPI_STATS_ENABLED
+	add_tick_count(TICK_SPI_WAIT, get_clock_micros() - wait_start);
+	add_tick_count(TICK_SPI_BYTES, 1);
+#endif
 	return SPDR0;
 }
\ No newline at end of file
@@ -14,6 +14,8 @@
 #include "snake.h"
 #include "board.h"
 #include "timer0.h"
+#include "game.h"
+#include "zobrist.h"
 
 uint8_t super_food_exists;
 
@@ -25,12 +27,11 @@ PosnType add_super_food(void) {
 	x = 0;
 	y = 0;
 	attempts = 0;
-	srandom(get_clock_ticks());
 	do {
 		// Generate a new position - this is based on a sequence rather
 		// then being random
-		x = random()%BOARD_WIDTH;
-		y = random()%BOARD_HEIGHT;
+		x = game_random()%BOARD_WIDTH;
+		y = game_random()%BOARD_HEIGHT;
 		test_position = position(x,y);
 		attempts++;
 	} while(attempts < 100 && 
@@ -43,8 +44,12 @@ PosnType add_super_food(void) {
 		*/
 		return INVALID_POSITION;
 	}
+	if(super_food_exists) {
+		zobrist_toggle(ZOBRIST_SUPER_FOOD, super_food_pos);
+	}
 	super_food_exists = 1;
 	super_food_pos = test_position;
+	zobrist_toggle(ZOBRIST_SUPER_FOOD, super_food_pos);
 	return test_position;	
 }
 
@@ -53,6 +58,9 @@ PosnType get_super_food_pos(void) {
 }
 
 void remove_super_food(void) {
+	if(super_food_exists) {
+		zobrist_toggle(ZOBRIST_SUPER_FOOD, super_food_pos);
+	}
 	super_food_exists = 0;
 	reset_superfood_status();
 }
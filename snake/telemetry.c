@@ -0,0 +1,110 @@
+/*
+ * telemetry.c
+ *
+ * Written by Hans Song
+ */
+
+#include "telemetry.h"
+#include "frame.h"
+#include "ledmatrix.h"
+#include "snake.h"
+#include "food.h"
+#include "rat.h"
+#include "superfood.h"
+#include "score.h"
+
+/* Whether telemetry has been asked for (takes effect from the next game)
+ * and whether it is being sent this game.
+ */
+static uint8_t telemetry_requested;
+static uint8_t telemetry_enabled;
+
+/* Score at the last frame, so steps can send the points scored. */
+static uint32_t last_score;
+
+void toggle_telemetry(void) {
+	telemetry_requested = !telemetry_requested;
+}
+
+uint8_t get_telemetry_enabled(void) {
+	return telemetry_enabled;
+}
+
+static void put_score(uint32_t score) {
+	for(uint8_t i = 0; i < 4; i++) {
+		frame_put(score & 0xFF);
+		score >>= 8;
+	}
+}
+
+void telemetry_prepare(void) {
+	telemetry_enabled = telemetry_requested;
+	ledmatrix_set_terminal_mirror(!telemetry_enabled);
+}
+
+void telemetry_start(void) {
+	uint8_t i, snake_length, num_food;
+	PosnType super_food_pos = INVALID_POSITION;
+	
+	if(!telemetry_enabled) {
+		return;
+	}
+	last_score = get_score();
+	snake_length = get_snake_length();
+	num_food = get_num_food_items();
+	if(get_super_food_existence()) {
+		super_food_pos = get_super_food_pos();
+	}
+	
+	frame_open(TELEMETRY_KEYFRAME, 1 + snake_length + 1 + num_food + 2 + 4);
+	frame_put(snake_length);
+	for(i = 0; i < snake_length; i++) {
+		frame_put(get_snake_position(i));
+	}
+	frame_put(num_food);
+	for(i = 0; i < num_food; i++) {
+		frame_put(get_position_of_food(i));
+	}
+	frame_put(get_rat_pos());
+	frame_put(super_food_pos);
+	put_score(last_score);
+	frame_close();
+}
+
+void telemetry_step(PosnType head, PosnType freed_tail) {
+	uint32_t score, points;
+	
+	if(!telemetry_enabled) {
+		return;
+	}
+	score = get_score();
+	points = score - last_score;
+	last_score = score;
+	
+	frame_open(TELEMETRY_STEP, 4);
+	frame_put(head);
+	frame_put(freed_tail);
+	frame_put(points > 255 ? 255 : points);
+	frame_put(get_snake_length());
+	frame_close();
+}
+
+void telemetry_item(uint8_t item, PosnType posn) {
+	if(!telemetry_enabled) {
+		return;
+	}
+	frame_open(TELEMETRY_ITEM, 2);
+	frame_put(item);
+	frame_put(posn);
+	frame_close();
+}
+
+void telemetry_end(void) {
+	if(!telemetry_enabled) {
+		return;
+	}
+	frame_open(TELEMETRY_END, 5);
+	put_score(get_score());
+	frame_put(get_snake_length());
+	frame_close();
+}
@@ -0,0 +1,77 @@
+/*
+ * telemetry.h
+ *
+ * Written by Hans Song
+ *
+ * Binary alternative to drawing the game on the serial terminal. Rather
+ * than moving the cursor and drawing a coloured block for every changed
+ * cell (around 20 characters each, plus the score), each change is sent as
+ * a small binary frame and a program on the host (tools/telemetry_view.py)
+ * keeps its own copy of the board and draws it. A snake step costs 8 bytes
+ * instead of a hundred or more, so the UART keeps up at the shortest move
+ * delay.
+ *
+ * The frames are laid out as described in frame.h. Other serial output
+ * (text, replay and export strings) can appear between them.
+ *
+ * Frame types and payloads:
+ *	TELEMETRY_KEYFRAME - the whole game state: snake length L, then L
+ *		positions from tail to head, number of food items F, then F food
+ *		positions, rat position, super food position (INVALID_POSITION if
+ *		none) and score (4 bytes, least significant first). Sent at the
+ *		start of each game.
+ *	TELEMETRY_STEP - the snake moved: new head position, position the tail
+ *		left (INVALID_POSITION if the snake grew), points scored by the
+ *		move (saturating at 255) and new snake length. Food at the new
+ *		head position has been eaten.
+ *	TELEMETRY_ITEM - an item appeared, moved or was removed: item type,
+ *		with TELEMETRY_REMOVED added if removed, then its position. There
+ *		is only ever one rat, so a rat item frame moves it (including when
+ *		the rat is eaten). Eating super food sends a removed frame before
+ *		the step.
+ *	TELEMETRY_END - game over: final score (4 bytes) and snake length.
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdint.h>
+#include "position.h"
+
+#define TELEMETRY_KEYFRAME	0x01
+#define TELEMETRY_STEP		0x02
+#define TELEMETRY_ITEM		0x03
+#define TELEMETRY_END		0x04
+
+#define TELEMETRY_FOOD		0x00
+#define TELEMETRY_SUPER_FOOD 0x01
+#define TELEMETRY_RAT		0x02
+#define TELEMETRY_REMOVED	0x80
+
+/* Turn telemetry on or off (from the start of the next game), and find
+ * out whether it is on for the current game. While it is on the board is
+ * not drawn on the terminal.
+ */
+void toggle_telemetry(void);
+uint8_t get_telemetry_enabled(void);
+
+/* Start of a game, before anything is drawn - telemetry is turned on or
+ * off as asked for, and the board drawn on the terminal or not to match.
+ */
+void telemetry_prepare(void);
+
+/* Start of a game - sends a keyframe. Call once the game and score have
+ * been initialised (after telemetry_prepare()).
+ */
+void telemetry_start(void);
+
+/* The snake moved (see TELEMETRY_STEP above). */
+void telemetry_step(PosnType head, PosnType freed_tail);
+
+/* An item appeared, moved or was removed (see TELEMETRY_ITEM above). */
+void telemetry_item(uint8_t item, PosnType posn);
+
+/* End of a game. */
+void telemetry_end(void);
+
+#endif /* TELEMETRY_H_ */
@@ -0,0 +1,89 @@
+/*
+ * tickstats.c
+ *
+ * Written by Hans Song
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/interrupt.h>
+
+#include "tickstats.h"
+#include "terminalio.h"
+
+static uint16_t current[NUM_TICK_COUNTERS];
+static uint16_t last[NUM_TICK_COUNTERS];
+static uint16_t maximum[NUM_TICK_COUNTERS];
+static uint32_t total[NUM_TICK_COUNTERS];
+static uint16_t ticks;
+
+static const char counter_names[NUM_TICK_COUNTERS][14] PROGMEM = {
+	"SPI bytes", "UART bytes", "SPI wait us", "UART wait us", "ADC wait us",
+	"move us"
+};
+
+void add_tick_count(uint8_t counter, uint16_t amount) {
+	/* UART bytes can be queued from anywhere, so don't let an interrupt
+	 * get in part way through.
+	 */
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	current[counter] = (current[counter] > UINT16_MAX - amount) ?
+			UINT16_MAX : current[counter] + amount;
+	if(interrupts_enabled) {
+		sei();
+	}
+}
+
+void end_tick(void) {
+	if(ticks == UINT16_MAX) {
+		return;
+	}
+	ticks++;
+	for(uint8_t i = 0; i < NUM_TICK_COUNTERS; i++) {
+		last[i] = current[i];
+		total[i] += current[i];
+		if(current[i] > maximum[i]) {
+			maximum[i] = current[i];
+		}
+		current[i] = 0;
+	}
+}
+
+void init_tick_stats(void) {
+	memset(current, 0, sizeof(current));
+	memset(last, 0, sizeof(last));
+	memset(maximum, 0, sizeof(maximum));
+	memset(total, 0, sizeof(total));
+	ticks = 0;
+}
+
+void print_tick_stats(void) {
+	/* Take a copy first since printing adds to the UART counters */
+	uint16_t last_copy[NUM_TICK_COUNTERS], max_copy[NUM_TICK_COUNTERS];
+	uint32_t total_copy[NUM_TICK_COUNTERS];
+	uint16_t num_ticks = ticks;
+	
+	memcpy(last_copy, last, sizeof(last));
+	memcpy(max_copy, maximum, sizeof(maximum));
+	memcpy(total_copy, total, sizeof(total));
+	
+	move_cursor(30,3);
+	printf_P(PSTR("%-13S %6S %6S %6S"), PSTR("per tick"), PSTR("last"),
+			PSTR("max"), PSTR("mean"));
+	for(uint8_t i = 0; i < NUM_TICK_COUNTERS; i++) {
+		move_cursor(30, 4 + i);
+#ifndef SPI_STATS_ENABLED
+		if(i == TICK_SPI_BYTES || i == TICK_SPI_WAIT) {
+			printf_P(PSTR("%-13S (SPI_STATS_ENABLED)"), counter_names[i]);
+			continue;
+		}
+#endif
+		printf_P(PSTR("%-13S %6u %6u %6lu"), counter_names[i], last_copy[i],
+				max_copy[i], num_ticks ? total_copy[i] / num_ticks : 0);
+	}
+	move_cursor(30, 4 + NUM_TICK_COUNTERS);
+	printf_P(PSTR("over %u ticks"), num_ticks);
+}
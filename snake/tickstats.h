@@ -0,0 +1,53 @@
+/*
+ * tickstats.h
+ *
+ * Written by Hans Song
+ *
+ * Counters of what each game tick (the time from one snake move to the
+ * next) cost, so a slow tick can be put down to game logic, the LED
+ * matrix (SPI) or the terminal (UART):
+ *	- bytes sent to the LED matrix over SPI
+ *	- bytes queued for the UART
+ *	- microseconds spent waiting for SPI transfers to finish
+ *	- microseconds spent waiting for room in the UART output buffer
+ *	- microseconds spent waiting for the ADC (joystick)
+ *	- microseconds taken to make the move itself (controller, game logic
+ *	  and drawing)
+ * For each counter the value for the last tick, the maximum and the mean
+ * over the game are kept. Times are in microseconds (see
+ * get_clock_micros()) and saturate at 65535.
+ *
+ * The SPI counters are only kept when SPI_STATS_ENABLED is defined. They
+ * are updated for every byte, and reading the clock twice per byte takes
+ * longer than the byte itself, which would slow every frame down (and
+ * inflate the SPI wait being measured).
+ */
+
+#ifndef TICKSTATS_H_
+#define TICKSTATS_H_
+
+#include <stdint.h>
+
+#define TICK_SPI_BYTES	0
+#define TICK_UART_BYTES	1
+#define TICK_SPI_WAIT	2
+#define TICK_UART_WAIT	3
+#define TICK_ADC_WAIT	4
+#define TICK_MOVE_TIME	5
+#define NUM_TICK_COUNTERS 6
+
+/* Add to a counter for the current tick. */
+void add_tick_count(uint8_t counter, uint16_t amount);
+
+/* Finish the current tick (call once per snake move) - the counters are
+ * added to the statistics and cleared for the next tick.
+ */
+void end_tick(void);
+
+/* Clear all the counters and statistics (at the start of a game). */
+void init_tick_stats(void);
+
+/* Write the statistics to the terminal. */
+void print_tick_stats(void);
+
+#endif /* TICKSTATS_H_ */
@@ -13,6 +13,7 @@
 
 #include "timer0.h"
 #include "superfood.h"
+#include "trace.h"
 
 /* Our internal clock tick count - incremented every 
  * millisecond. Will overflow every ~49 days.
@@ -79,12 +80,36 @@ uint32_t get_clock_ticks(void) {
 	return return_value;
 }
 
+uint32_t get_clock_micros(void) {
+	uint32_t ticks;
+	uint8_t count;
+	
+	/* Read the tick count and the timer together. If the compare match
+	 * has happened but the interrupt hasn't been serviced yet (the flag
+	 * is still set) then the timer has wrapped and the tick count is one
+	 * behind.
+	 */
+	uint8_t interrupts_were_on = bit_is_set(SREG, SREG_I);
+	cli();
+	ticks = clock_ticks;
+	count = TCNT0;
+	if(bit_is_set(TIFR0, OCF0A) && count < OCR0A) {
+		ticks++;
+	}
+	if(interrupts_were_on) {
+		sei();
+	}
+	/* Each timer count is 64 clock cycles = 8 microseconds */
+	return ticks * 1000 + count * 8;
+}
+
 /* Interrupt handler which fires when timer/counter 0 reaches 
  * the defined output compare value (every millisecond)
  */
 ISR(TIMER0_COMPA_vect) {
 	/* Increment our clock tick count */
 	clock_ticks++;
+	TRACE_TICK();
 	super_food_timer++;
 	super_food_timer = super_food_timer%20000;
 	
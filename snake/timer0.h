@@ -31,6 +31,12 @@ void init_timer0(void);
  */
 uint32_t get_clock_ticks(void);
 
+/* Return the time since the timer was initialised in microseconds, to a
+ * resolution of 8 microseconds (one count of the timer). Useful for timing
+ * short pieces of code. Will overflow every ~71 minutes.
+ */
+uint32_t get_clock_micros(void);
+
 uint8_t get_super_food_status(void);
 
 void reset_superfood_timer(void);
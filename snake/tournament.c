@@ -0,0 +1,166 @@
+/*
+ * tournament.c
+ *
+ * Written by Hans Song
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+
+#include "tournament.h"
+#include "controller.h"
+#include "game.h"
+#include "terminalio.h"
+
+/* Histograms have TOURNAMENT_BUCKETS buckets. Bucket 0 holds values below
+ * 2^shift, bucket 1 values below 2^(shift+1) and so on; the last bucket
+ * holds everything larger. The shift for each metric is chosen so the
+ * buckets cover its usual range.
+ */
+#define TOURNAMENT_BUCKETS 8
+static const uint8_t bucket_shift[NUM_METRICS] PROGMEM = {4, 0, 4};
+
+typedef struct {
+	uint32_t games;
+	uint32_t survived;
+	float mean[NUM_METRICS];
+	float m2[NUM_METRICS];
+	uint16_t buckets[NUM_METRICS][TOURNAMENT_BUCKETS];
+} ControllerStats;
+
+static ControllerStats stats[NUM_CONTROLLERS];
+
+static uint8_t tournament_mode;
+static uint8_t tournament_controller;
+static uint32_t tournament_seed;
+
+static uint8_t bucket_of(uint8_t metric, uint32_t value) {
+	uint8_t bucket = 0;
+	value >>= pgm_read_byte(&bucket_shift[metric]);
+	while(value && bucket < TOURNAMENT_BUCKETS - 1) {
+		value >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+static void add_value(ControllerStats* s, uint8_t metric, uint32_t value) {
+	uint16_t* buckets = s->buckets[metric];
+	uint8_t bucket = bucket_of(metric, value);
+	float delta = value - s->mean[metric];
+	
+	s->mean[metric] += delta / s->games;
+	s->m2[metric] += delta * (value - s->mean[metric]);
+	
+	if(buckets[bucket] == UINT16_MAX) {
+		/* Halve every count so the proportions (and so the quantiles)
+		 * are kept.
+		 */
+		for(uint8_t i = 0; i < TOURNAMENT_BUCKETS; i++) {
+			buckets[i] = (buckets[i] + 1) >> 1;
+		}
+	}
+	buckets[bucket]++;
+}
+
+void tournament_record_game(uint8_t controller, uint32_t score,
+		uint8_t length, uint32_t steps, uint8_t survived) {
+	ControllerStats* s = &stats[controller];
+	s->games++;
+	s->survived += survived;
+	add_value(s, METRIC_SCORE, score);
+	add_value(s, METRIC_LENGTH, length);
+	add_value(s, METRIC_STEPS, steps);
+}
+
+uint32_t get_tournament_games(uint8_t controller) {
+	return stats[controller].games;
+}
+
+uint32_t get_tournament_survived(uint8_t controller) {
+	return stats[controller].survived;
+}
+
+float get_tournament_mean(uint8_t controller, uint8_t metric) {
+	return stats[controller].mean[metric];
+}
+
+float get_tournament_variance(uint8_t controller, uint8_t metric) {
+	if(stats[controller].games < 2) {
+		return 0;
+	}
+	return stats[controller].m2[metric] / (stats[controller].games - 1);
+}
+
+uint32_t get_tournament_quantile(uint8_t controller, uint8_t metric,
+		uint8_t percent) {
+	const uint16_t* buckets = stats[controller].buckets[metric];
+	uint32_t total = 0, count = 0;
+	uint8_t i;
+	
+	for(i = 0; i < TOURNAMENT_BUCKETS; i++) {
+		total += buckets[i];
+	}
+	for(i = 0; i < TOURNAMENT_BUCKETS - 1; i++) {
+		count += buckets[i];
+		if(count * 100 >= total * percent) {
+			break;
+		}
+	}
+	return (1UL << (i + pgm_read_byte(&bucket_shift[metric]))) - 1;
+}
+
+void clear_tournament(void) {
+	memset(stats, 0, sizeof(stats));
+}
+
+void toggle_tournament_mode(void) {
+	tournament_mode = !tournament_mode;
+	tournament_controller = CONTROLLER_HUMAN;
+	tournament_seed = 0;
+}
+
+uint8_t get_tournament_mode(void) {
+	return tournament_mode;
+}
+
+uint32_t tournament_next_game(void) {
+	/* Cycle through the built in controllers, moving on to the next
+	 * seed once they have all played the current one.
+	 */
+	if(++tournament_controller == NUM_CONTROLLERS) {
+		tournament_controller = CONTROLLER_HUMAN + 1;
+	}
+	if(tournament_controller == CONTROLLER_HUMAN + 1) {
+		tournament_seed++;
+	}
+	set_controller(tournament_controller);
+	return tournament_seed;
+}
+
+void print_tournament_result(uint8_t controller, uint32_t score,
+		uint8_t length, uint32_t steps, uint8_t survived) {
+	static const char metric_names[NUM_METRICS][7] PROGMEM = {
+		"score", "length", "steps"
+	};
+	
+	move_cursor(1,20);
+	printf_P(PSTR("T,%u,%lu,%lu,%u,%lu,%u\n"), controller, get_game_seed(),
+			score, length, steps, survived);
+	printf_P(PSTR("Controller %u: %lu games, %lu survived %u steps\n"),
+			controller, get_tournament_games(controller),
+			get_tournament_survived(controller), TOURNAMENT_MAX_STEPS);
+	/* printf() isn't linked with floating point support, so means and
+	 * standard deviations are rounded to whole numbers.
+	 */
+	for(uint8_t metric = 0; metric < NUM_METRICS; metric++) {
+		printf_P(PSTR("%-6S mean %5lu sd %5lu median <=%lu 90%% <=%lu\n"),
+				metric_names[metric],
+				(uint32_t)(get_tournament_mean(controller, metric) + 0.5f),
+				(uint32_t)(sqrtf(get_tournament_variance(controller, metric)) + 0.5f),
+				get_tournament_quantile(controller, metric, 50),
+				get_tournament_quantile(controller, metric, 90));
+	}
+}
@@ -0,0 +1,81 @@
+/*
+ * tournament.h
+ *
+ * Written by Hans Song
+ *
+ * Results of every game, kept per controller so that controllers can be
+ * compared. Rather than storing each result, running statistics are
+ * updated as each game finishes so any number of games fits in the same
+ * (small) amount of RAM:
+ *	- the mean and variance of each metric, using Welford's method
+ *	- a histogram of each metric with power of two sized buckets, from
+ *	  which quantiles can be estimated (to within a factor of two). Two
+ *	  histograms covering different sets of games can be merged by adding
+ *	  their counts.
+ *
+ * In tournament mode games run back to back without waiting for the
+ * player. Each built in controller plays each seed in turn (seeds 1, 2,
+ * 3, ...), so they all face the same games, and the result of each game
+ * is written to the terminal as a line of comma separated values:
+ *	T,<controller>,<seed>,<score>,<length>,<steps>,<survived>
+ * so a host can collect them. Some controllers (e.g. the Hamiltonian
+ * cycle) never die, so a tournament game is ended after
+ * TOURNAMENT_MAX_STEPS moves; survived is 1 if the game was ended that
+ * way and 0 if the snake died.
+ */
+
+#ifndef TOURNAMENT_H_
+#define TOURNAMENT_H_
+
+#include <stdint.h>
+
+/* Moves after which a tournament game is ended (as survived). Can be set
+ * when building.
+ */
+#ifndef TOURNAMENT_MAX_STEPS
+#define TOURNAMENT_MAX_STEPS 2000
+#endif
+
+/* Metrics kept for each game */
+#define METRIC_SCORE	0
+#define METRIC_LENGTH	1
+#define METRIC_STEPS	2	/* number of moves the snake survived */
+#define NUM_METRICS		3
+
+/* Add the result of a game played by the given controller. survived is
+ * 1 if the game was ended at TOURNAMENT_MAX_STEPS rather than by the
+ * snake dying.
+ */
+void tournament_record_game(uint8_t controller, uint32_t score,
+		uint8_t length, uint32_t steps, uint8_t survived);
+
+/* Statistics for a controller. Quantiles are given as a percentage (e.g.
+ * 50 for the median) and return the top of the histogram bucket the
+ * quantile falls in.
+ */
+uint32_t get_tournament_games(uint8_t controller);
+uint32_t get_tournament_survived(uint8_t controller);
+float get_tournament_mean(uint8_t controller, uint8_t metric);
+float get_tournament_variance(uint8_t controller, uint8_t metric);
+uint32_t get_tournament_quantile(uint8_t controller, uint8_t metric,
+		uint8_t percent);
+
+/* Forget all results. */
+void clear_tournament(void);
+
+/* Turn tournament mode on (starting again from the first seed) or off. */
+void toggle_tournament_mode(void);
+uint8_t get_tournament_mode(void);
+
+/* In tournament mode, choose the controller for the next game and return
+ * its seed.
+ */
+uint32_t tournament_next_game(void);
+
+/* Write the result of the game just finished as a line of comma
+ * separated values, and a summary of the controller's results so far.
+ */
+void print_tournament_result(uint8_t controller, uint32_t score,
+		uint8_t length, uint32_t steps, uint8_t survived);
+
+#endif /* TOURNAMENT_H_ */
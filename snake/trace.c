@@ -0,0 +1,45 @@
+/*
+ * trace.c
+ *
+ * Written by Hans Song
+ */
+
+#include "trace.h"
+
+#ifdef TRACE_ENABLED
+
+#include <stdio.h>
+#include <avr/pgmspace.h>
+
+TraceEntry trace_buffer[TRACE_SIZE];
+uint8_t trace_index;
+volatile uint16_t trace_ticks;
+
+static const char hex_digits[16] PROGMEM = "0123456789ABCDEF";
+
+static void trace_put_hex(uint8_t byte) {
+	putchar(pgm_read_byte(&hex_digits[byte >> 4]));
+	putchar(pgm_read_byte(&hex_digits[byte & 0x0F]));
+}
+
+void trace_dump(void) {
+	/* Start from the oldest entry. Unused entries have an event code of
+	 * 0 and are skipped by the host tool. Events recorded while we dump
+	 * may overwrite entries not yet written out.
+	 */
+	uint8_t index = trace_index;
+	putchar('\x1b');
+	putchar('_');
+	putchar('T');
+	for(uint8_t i = 0; i < TRACE_SIZE; i++) {
+		const TraceEntry* entry = &trace_buffer[(index + i) & (TRACE_SIZE - 1)];
+		trace_put_hex(entry->tick & 0xFF);
+		trace_put_hex(entry->tick >> 8);
+		trace_put_hex(entry->event);
+		trace_put_hex(entry->arg);
+	}
+	putchar('\x1b');
+	putchar('\\');
+}
+
+#endif /* TRACE_ENABLED */
@@ -0,0 +1,90 @@
+/*
+ * trace.h
+ *
+ * Written by Hans Song
+ *
+ * Event trace for tracking down glitches. Events from the game, input
+ * handling and interrupt handlers are recorded in a ring buffer in RAM
+ * (TRACE_SIZE entries - the oldest are overwritten) as a 16 bit
+ * millisecond tick, an event code and an argument byte. Recording an
+ * event takes a couple of dozen cycles.
+ *
+ * The buffer is dumped over the UART (as hex inside an ESC _ T ... ESC \
+ * string, oldest entry first, 4 bytes per entry: tick (least significant
+ * byte first), event, argument) at game over and when 'd' is pressed.
+ * tools/trace_dump.py turns a dump into a readable timeline.
+ *
+ * Tracing is only compiled in when TRACE_ENABLED is defined. Otherwise
+ * TRACE() and the other macros below expand to nothing, so there is no
+ * cost at all.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+
+/* Event codes, with what the argument holds */
+#define TRACE_GAME_START	0x01	/* controller */
+#define TRACE_GAME_OVER		0x02	/* snake length */
+#define TRACE_BUTTON		0x03	/* button pushed (from the ISR) */
+#define TRACE_SERIAL_RX		0x04	/* character received (from the ISR) */
+#define TRACE_SERIAL_LOST	0x05	/* character lost - input buffer full */
+#define TRACE_DIRN			0x06	/* next snake direction set */
+#define TRACE_SNAKE_MOVE	0x07	/* result of advance_snake_head() */
+#define TRACE_COLLISION		0x08	/* position the head ran into */
+#define TRACE_FOOD_ADDED	0x09	/* position */
+#define TRACE_FOOD_EATEN	0x0A	/* position */
+#define TRACE_RAT_MOVE		0x0B	/* new position */
+#define TRACE_RAT_STUCK		0x0C	/* position the rat is stuck at */
+#define TRACE_SUPER_FOOD	0x0D	/* position, or INVALID_POSITION if removed */
+
+#ifdef TRACE_ENABLED
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/* Number of entries (must be a power of 2) */
+#ifndef TRACE_SIZE
+#define TRACE_SIZE 64
+#endif
+
+typedef struct {
+	uint16_t tick;
+	uint8_t event;
+	uint8_t arg;
+} TraceEntry;
+
+extern TraceEntry trace_buffer[TRACE_SIZE];
+extern uint8_t trace_index;
+extern volatile uint16_t trace_ticks;
+
+static inline void trace(uint8_t event, uint8_t arg) {
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	TraceEntry* entry = &trace_buffer[trace_index];
+	trace_index = (trace_index + 1) & (TRACE_SIZE - 1);
+	entry->tick = trace_ticks;
+	entry->event = event;
+	entry->arg = arg;
+	if(interrupts_enabled) {
+		sei();
+	}
+}
+
+/* Write the trace out over the UART */
+void trace_dump(void);
+
+#define TRACE(event, arg) trace((event), (arg))
+/* Called every millisecond by the timer 0 interrupt handler */
+#define TRACE_TICK() (trace_ticks++)
+
+#else
+
+#define TRACE(event, arg)
+#define TRACE_TICK()
+#define trace_dump()
+
+#endif /* TRACE_ENABLED */
+
+#endif /* TRACE_H_ */
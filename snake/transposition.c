@@ -0,0 +1,41 @@
+/*
+ * transposition.c
+ *
+ * Written by Hans Song
+ */
+
+#include "transposition.h"
+
+static TranspositionEntry table[TRANSPOSITION_TABLE_SIZE];
+
+void clear_transposition_table(void) {
+	for(uint8_t i = 0; i < TRANSPOSITION_TABLE_SIZE; i++) {
+		table[i].depth = 0;
+	}
+}
+
+uint8_t probe_transposition_table(uint64_t hash, int16_t* value,
+		uint8_t* depth, uint8_t* move) {
+	TranspositionEntry* entry = &table[(uint8_t)hash & (TRANSPOSITION_TABLE_SIZE - 1)];
+	if(entry->depth == 0 || entry->check != (uint32_t)(hash >> 32)) {
+		return 0;
+	}
+	*value = entry->value;
+	*depth = entry->depth - 1;
+	*move = entry->move;
+	return 1;
+}
+
+void store_transposition_table(uint64_t hash, int16_t value,
+		uint8_t depth, uint8_t move) {
+	TranspositionEntry* entry = &table[(uint8_t)hash & (TRANSPOSITION_TABLE_SIZE - 1)];
+	uint32_t check = hash >> 32;
+	if(entry->depth != 0 && entry->check == check && entry->depth > depth + 1) {
+		/* Keep the deeper result we already have */
+		return;
+	}
+	entry->check = check;
+	entry->value = value;
+	entry->depth = depth + 1;
+	entry->move = move;
+}
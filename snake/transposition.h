@@ -0,0 +1,60 @@
+/*
+ * transposition.h
+ *
+ * Written by Hans Song
+ *
+ * A small transposition table for search-based controllers. Results of
+ * searching a position are stored against the position's Zobrist hash
+ * (see zobrist.h) so that a position reached again by a different order
+ * of moves does not have to be searched again. (Once the snake has
+ * travelled further than its length, its body is just the last cells the
+ * head passed through, so different paths can lead to the same position.)
+ *
+ * The table is direct mapped: the low bits of the hash pick the entry and
+ * the upper 32 bits are kept to check that a stored entry is for the same
+ * position. There is no locking - the table is only ever used from the
+ * main loop, never from an interrupt handler.
+ */
+
+#ifndef TRANSPOSITION_H_
+#define TRANSPOSITION_H_
+
+#include <stdint.h>
+
+/* Number of entries in the table. Must be a power of two. Each entry
+ * takes 8 bytes of RAM.
+ */
+#ifndef TRANSPOSITION_TABLE_SIZE
+#ifdef SRAM_DIET
+#define TRANSPOSITION_TABLE_SIZE 8
+#else
+#define TRANSPOSITION_TABLE_SIZE 16
+#endif
+#endif
+
+typedef struct {
+	uint32_t check;		/* upper 32 bits of the position's hash */
+	int16_t value;		/* search result for the position */
+	uint8_t depth;		/* depth the position was searched to, plus one (0 = empty) */
+	uint8_t move;		/* best move found (e.g. a SnakeDirnType) */
+} TranspositionEntry;
+
+/* Empty the table. */
+void clear_transposition_table(void);
+
+/* Look up the given position. Returns 1 and fills in value, depth and
+ * move if the position is in the table, 0 otherwise. (The entry is
+ * returned however deep it was searched - the caller decides whether
+ * depth is sufficient.)
+ */
+uint8_t probe_transposition_table(uint64_t hash, int16_t* value,
+		uint8_t* depth, uint8_t* move);
+
+/* Store the result of searching a position to the given depth. The
+ * existing entry in the slot is replaced unless it is for the same
+ * position and was searched more deeply.
+ */
+void store_transposition_table(uint64_t hash, int16_t value,
+		uint8_t depth, uint8_t move);
+
+#endif /* TRANSPOSITION_H_ */
@@ -0,0 +1,115 @@
+/*
+ * zobrist.c
+ *
+ * Written by Hans Song
+ */
+
+#include <avr/pgmspace.h>
+
+#include "zobrist.h"
+#include "snake.h"
+#include "food.h"
+#include "rat.h"
+#include "superfood.h"
+
+/* Random keys for each of the 128 board cells, indexed by (x * 8 + y).
+ * These are kept in program memory. Rather than store a full table for
+ * each kind of item, the key for kind k is the cell key rotated by k
+ * bytes (so there can be at most 8 kinds).
+ */
+static const uint64_t cell_keys[128] PROGMEM = {
+	0x6707B38E217DC9C9ULL, 0x752B12AEFB1D27D8ULL, 0x11B09D6A35AAA3D2ULL, 0xF40D1BB89E1A8515ULL,
+	0xF9BAEC7211F93FCEULL, 0x43DC7C1D5BD338EBULL, 0xA18A5A595CA949C2ULL, 0x4306A0FD62A60A62ULL,
+	0xB85B1DA47A0C299EULL, 0x30F3DA925306A6C3ULL, 0x8B7D26189230CA9AULL, 0xA1A059B4C6DC4E84ULL,
+	0x0C51AECC3A7031E2ULL, 0x33C1356AB3F3E485ULL, 0x019EDEBE92F5662FULL, 0x06BB8BC94B4C0DF3ULL,
+	0xAE6F3026CB10FE08ULL, 0x8391D3BCBAB71966ULL, 0x5447BBAB68C1BF67ULL, 0xF914E1CC19AB0454ULL,
+	0x4CA8983493764ECCULL, 0x250CEBD7985DF281ULL, 0x6B46A6539F8111A4ULL, 0xDAB9C10180DB8CB4ULL,
+	0xFEDF665A89CC7649ULL, 0x548FE20ABE34143DULL, 0xA2BB5498057CD268ULL, 0x29227AB4EDCE1A7AULL,
+	0x7A8677ADA6857697ULL, 0x4C1562109FF960EBULL, 0x9FB8669C5D9ECA7BULL, 0xD008D014A94FF69BULL,
+	0x0DAB2CF01AE8D256ULL, 0x501E5E384D93FD1FULL, 0x3D94B4C766A1EBDFULL, 0x64CCD346B6528319ULL,
+	0x22C0BF6C89B7C7AAULL, 0x7140A5FE07588EBBULL, 0x07620E6B189C2EDFULL, 0x885C6A9B7CB262AAULL,
+	0x832933D544DBFCC1ULL, 0x0953727CE21DE04BULL, 0x51D1FDEEA1C02BC5ULL, 0xBA8BE1BEF029EE6FULL,
+	0x46147DF3F6D03E7CULL, 0x0B54C3A3153FB9DEULL, 0x350282699B0C814BULL, 0xAD539ECB31D87F5FULL,
+	0x2D6C9D3E3A8ECEB5ULL, 0x538764C0C1B83414ULL, 0x2EC29C9776AB276BULL, 0xC7E4EBE6B53BB43DULL,
+	0x63FA84711077682CULL, 0x7C4BEF7568E036ECULL, 0xF103C47E0050E77AULL, 0x3B8FA28E0AB325E2ULL,
+	0x3F74B0C31FCDC8E7ULL, 0x8C4C3B8F0FA067CEULL, 0xA694C7DC4C56EE9CULL, 0xD8471C3A1577FCD5ULL,
+	0xCC9658CFCC62F816ULL, 0x57DD1484838BEDD3ULL, 0xDA5A3ED436D5BB3FULL, 0xF139F032D1DF91B7ULL,
+	0xB7F111113D6C73D6ULL, 0xB64B7E8198445B96ULL, 0xCCE3D96381250B50ULL, 0x6471BE9443F81F4FULL,
+	0xC312B3AE48CA209AULL, 0x1B1C823E09737546ULL, 0x3A4189218BA0CFABULL, 0xC90EE5717690E129ULL,
+	0xD5DA3B07271A1BBAULL, 0x495024543DF15397ULL, 0x0B7EBC2007FA6E49ULL, 0x90CA5AC4C9DEED1DULL,
+	0xBD6C614DBA165BE3ULL, 0x900ADEDB41B5CA54ULL, 0xD4862FDB10091AB0ULL, 0xFA94F33E69FCB867ULL,
+	0x0F8833B803655133ULL, 0x8503CD29DC13F829ULL, 0x919757DDE3F2A28FULL, 0xFAB8566A42DFB7B2ULL,
+	0x30FF36848D5C3F87ULL, 0x8BE57EB155160D87ULL, 0x7F75C52D8949E55EULL, 0x156B42C09E1471E3ULL,
+	0xD2F59114F9A8974EULL, 0x22E7A489E2BA7A4CULL, 0x17F5CD38C2241EF0ULL, 0x4B757A65509EB6BAULL,
+	0xC9D1785D6E10CD07ULL, 0x4C0054BC1FFC240BULL, 0xB5576A12CAE771CFULL, 0x1C8E15051C5DEB0FULL,
+	0x0B649F811CCF9BFBULL, 0xFA71C3C86F4C9562ULL, 0xB0CF8F2A09103CA6ULL, 0x77ADC5574FE9569FULL,
+	0x6372E2B29FEE9DC0ULL, 0xE733BBB000DEEB67ULL, 0xC153AD42E5729732ULL, 0x5B3B4961167CCBDBULL,
+	0xC01FF255F8A834A2ULL, 0x396B6BCA1B45637FULL, 0xE38064745D3AB70FULL, 0x6A2A6DD7222B34DCULL,
+	0x1D7D134FA3A334DDULL, 0x4E0E9E3C341F67D7ULL, 0xCA8B531ED306DA19ULL, 0x0FB3D97B3897474DULL,
+	0xF6D7E35DA528B5BFULL, 0xDFEF3DF542D024DCULL, 0x6E79CA5A45221B79ULL, 0x5FA207015F41DB09ULL,
+	0x4D4D2E95D195F6D8ULL, 0xFA38B956BFEBC135ULL, 0x0B0FF20557C57413ULL, 0x34A0BA247B891A03ULL,
+	0x79E307E4250AF7EFULL, 0xAC71428484EA4797ULL, 0x0A7B2BB86230FBF0ULL, 0xE3A2CCCB5C945F50ULL,
+	0x7876244737C1F401ULL, 0x53121CD14E3AA704ULL, 0x345F01A5C7DEE165ULL, 0x32FEED71744E3C11ULL
+};
+
+/* Random keys for each snake direction */
+static const uint64_t dirn_keys[4] PROGMEM = {
+	0x7E6BC24124D87793ULL, 0x0B9E4E456A23CD60ULL, 0x9F422DBE4E871139ULL, 0x480B0B3B765487D0ULL
+};
+
+static uint64_t zobrist_hash;
+
+/* XOR the (rotated) key at the given program memory address into the
+ * hash. We work a byte at a time which is cheap on the AVR (compared to
+ * 64 bit shifts).
+ */
+static void toggle_key(uint64_t* hash, const uint64_t* key, uint8_t rotation) {
+	uint8_t* hash_bytes = (uint8_t*)hash;
+	const uint8_t* key_bytes = (const uint8_t*)key;
+	for(uint8_t i = 0; i < 8; i++) {
+		hash_bytes[i] ^= pgm_read_byte(&key_bytes[(i + rotation) & 0x07]);
+	}
+}
+
+static void toggle_cell(uint64_t* hash, uint8_t kind, PosnType posn) {
+	if(is_position_valid(posn)) {
+		toggle_key(hash, &cell_keys[(x_position(posn) << 3) | y_position(posn)], kind);
+	}
+}
+
+void zobrist_toggle(uint8_t kind, PosnType posn) {
+	toggle_cell(&zobrist_hash, kind, posn);
+}
+
+void zobrist_toggle_dirn(SnakeDirnType dirn) {
+	toggle_key(&zobrist_hash, &dirn_keys[dirn], 0);
+}
+
+uint64_t get_zobrist_hash(void) {
+	return zobrist_hash;
+}
+
+uint64_t zobrist_compute(void) {
+	uint64_t hash = 0;
+	uint8_t i;
+	uint8_t length = get_snake_length();
+	
+	for(i = 0; i < length - 1; i++) {
+		toggle_cell(&hash, ZOBRIST_SNAKE_BODY + get_snake_segment_dirn(i),
+				get_snake_position(i));
+	}
+	toggle_cell(&hash, ZOBRIST_SNAKE_HEAD, get_snake_head_position());
+	toggle_key(&hash, &dirn_keys[get_snake_dirn()], 0);
+	for(i = 0; i < get_num_food_items(); i++) {
+		toggle_cell(&hash, ZOBRIST_FOOD, get_position_of_food(i));
+	}
+	if(get_super_food_existence()) {
+		toggle_cell(&hash, ZOBRIST_SUPER_FOOD, get_super_food_pos());
+	}
+	toggle_cell(&hash, ZOBRIST_RAT, get_rat_pos());
+	return hash;
+}
+
+void zobrist_recompute(void) {
+	zobrist_hash = zobrist_compute();
+}
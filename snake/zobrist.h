@@ -0,0 +1,65 @@
+/*
+ * zobrist.h
+ *
+ * Written by Hans Song
+ *
+ * Incremental 64 bit Zobrist hash of the game state. Each (kind of item,
+ * board cell) pair and each snake direction has a fixed random key and
+ * the hash is the XOR of the keys for everything currently on the board.
+ * Adding or removing an item toggles its key, so the modules that move
+ * things around (snake.c, food.c, rat.c, superfood.c) keep the hash up to
+ * date as they go.
+ *
+ * Each body cell is keyed by the direction the snake left it in (towards
+ * the head), not just by being part of the snake. The set of body cells
+ * alone doesn't fix the order of the segments or which end is the tail
+ * (e.g. a snake coiled clockwise rather than anticlockwise), but with the
+ * directions and the head the whole snake can be traced back from the
+ * head. Identical positions (same snake, food, super food, rat and
+ * direction) therefore have identical hashes and different positions
+ * almost certainly don't, so the hash is a cheap digest of the position
+ * (e.g. to seed a controller's random numbers, as the key of the
+ * transposition table - see transposition.h - or in a bot's status - see
+ * botlink.h).
+ */
+
+#ifndef ZOBRIST_H_
+#define ZOBRIST_H_
+
+#include <stdint.h>
+#include "position.h"
+#include "snake.h"
+
+/* Kinds of item that can occupy a cell. A body cell is
+ * ZOBRIST_SNAKE_BODY plus the direction to the next cell towards the head
+ * (a SnakeDirnType).
+ */
+#define ZOBRIST_SNAKE_BODY	0
+#define ZOBRIST_SNAKE_HEAD	4
+#define ZOBRIST_FOOD		5
+#define ZOBRIST_SUPER_FOOD	6
+#define ZOBRIST_RAT			7
+
+/* Toggle the key for an item of the given kind at the given position
+ * (i.e. add it to or remove it from the hash). Invalid positions are
+ * ignored.
+ */
+void zobrist_toggle(uint8_t kind, PosnType posn);
+
+/* Toggle the key for the given snake direction. */
+void zobrist_toggle_dirn(SnakeDirnType dirn);
+
+/* Return the current hash. */
+uint64_t get_zobrist_hash(void);
+
+/* Compute the hash of the current game state from scratch. (This should
+ * always equal get_zobrist_hash() - run_benchmarks() checks that it does.)
+ */
+uint64_t zobrist_compute(void);
+
+/* Set the current hash from scratch. Must be called once the board has
+ * been set up for a new game.
+ */
+void zobrist_recompute(void);
+
+#endif /* ZOBRIST_H_ */
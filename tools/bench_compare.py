@@ -0,0 +1,56 @@
+#!/usr/bin/env python3
+"""Compare two benchmark runs of the snake firmware.
+
+Press 'b' during a game to run the benchmarks (see benchmark.h); they
+write lines of the form
+
+    B,<function>,<snake length>,<samples>,<min>,<median>,<max>
+
+to the terminal. Capture the serial output of a run on each version of
+the code and pass both captures to this script:
+
+    bench_compare.py <before> <after> [threshold %]
+
+It prints the median cycle counts side by side and flags any that got
+slower by more than the threshold (default 5%). The exit status is 1 if
+anything did, so it can be used in scripts.
+"""
+
+import re
+import sys
+
+LINE = re.compile(rb'B,(\w+),(\d+),(\d+),(\d+),(\d+),(\d+)')
+
+
+def read_run(path):
+    """Return {(function, length): median cycles} for a capture."""
+    with open(path, 'rb') as capture:
+        return {(m.group(1).decode(), int(m.group(2))): int(m.group(5))
+                for m in LINE.finditer(capture.read())}
+
+
+def main():
+    if len(sys.argv) not in (3, 4):
+        sys.exit('usage: %s <before> <after> [threshold %%]' % sys.argv[0])
+    before = read_run(sys.argv[1])
+    after = read_run(sys.argv[2])
+    threshold = float(sys.argv[3]) if len(sys.argv) == 4 else 5.0
+    slower = False
+    print('%-30s %6s %8s %8s %7s' % ('function', 'length', 'before',
+                                      'after', 'change'))
+    for key in sorted(set(before) & set(after)):
+        old, new = before[key], after[key]
+        change = 100.0 * (new - old) / old if old else 0.0
+        flag = ''
+        if change > threshold:
+            flag = '  SLOWER'
+            slower = True
+        print('%-30s %6d %8d %8d %+6.1f%%%s' % (key + (old, new, change, flag)))
+    for key in sorted(set(before) ^ set(after)):
+        print('%-30s %6d only in %s' % (key + ('before' if key in before
+                                                  else 'after',)))
+    sys.exit(1 if slower else 0)
+
+
+if __name__ == '__main__':
+    main()
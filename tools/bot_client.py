@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+"""Play the snake firmware from the host over its bot command channel.
+
+Drives the game in lockstep mode (see botlink.h): the snake only moves
+when this script sends a move, so games run as fast as the UART allows.
+The board is followed through the binary telemetry frames (see
+telemetry.h), so switch telemetry on with 'v' first; the script sends
+'n' to start each game. Each move heads for the nearest food without
+running into the snake.
+
+    bot_client.py /dev/ttyUSB0 [--games 10]
+
+Needs pyserial. The BotLink class can be used on its own to write other
+bots.
+"""
+
+import argparse
+import sys
+
+from telemetry_view import FrameReader, Board, END
+
+MOVES, LOCKSTEP, STATUS = 0x11, 0x12, 0x21
+STATUS_ALIVE, STATUS_MOVED, STATUS_NEW_GAME = 0x01, 0x02, 0x08
+UP, RIGHT, DOWN, LEFT = range(4)
+WIDTH, HEIGHT = 16, 8
+
+
+def frame(kind, payload):
+    """Encode a frame (see frame.h)."""
+    body = bytes([kind, len(payload)]) + bytes(payload)
+    crc = 0
+    for byte in body:
+        crc ^= byte
+        for _ in range(8):
+            crc = (crc << 1 ^ 0x07 if crc & 0x80 else crc << 1) & 0xFF
+    return bytes([0xA5]) + body + bytes([crc])
+
+
+class BotLink:
+    """Commands to, and status and telemetry from, the board."""
+
+    def __init__(self, port):
+        self.port = port
+        self.reader = FrameReader()
+        self.board = Board()
+        self.seq = 0
+
+    def send_moves(self, moves):
+        self.port.write(frame(MOVES, [self.seq] + list(moves)))
+        self.seq = (self.seq + len(moves)) & 0xFF
+
+    def set_lockstep(self, on):
+        self.port.write(frame(LOCKSTEP, [1 if on else 0]))
+
+    def next_status(self):
+        """Read until a status frame arrives, following the board on the
+        way. Returns (next_seq, queued, flags, length, digest). The
+        digest can only be compared with other digests (see botlink.h)."""
+        while True:
+            data = self.port.read(64)
+            for kind, payload in self.reader.feed(data):
+                if kind == STATUS:
+                    self.seq = payload[0]
+                    return (payload[0], payload[1], payload[2], payload[3],
+                            int.from_bytes(payload[4:8], 'little'))
+                self.board.apply(kind, payload)
+
+
+def step(posn, dirn):
+    x, y = posn >> 4, posn & 0x07
+    if dirn == UP:
+        y = (y + 1) % HEIGHT
+    elif dirn == DOWN:
+        y = (y - 1) % HEIGHT
+    elif dirn == RIGHT:
+        x = (x + 1) % WIDTH
+    else:
+        x = (x - 1) % WIDTH
+    return x << 4 | y
+
+
+def distance(a, b):
+    dx = abs((a >> 4) - (b >> 4))
+    dy = abs((a & 0x07) - (b & 0x07))
+    return min(dx, WIDTH - dx) + min(dy, HEIGHT - dy)
+
+
+def choose(board):
+    """Pick a move for the board: the safe move closest to food."""
+    snake = list(board.snake)
+    if not snake:
+        return RIGHT
+    head = snake[-1]
+    body = set(snake[1:])               # the tail will have moved on
+    targets = list(board.food) or [head]
+    best = None
+    for dirn in (UP, RIGHT, DOWN, LEFT):
+        cell = step(head, dirn)
+        if len(snake) > 1 and cell == snake[-2]:
+            continue                    # can't reverse
+        score = (cell in body, min(distance(cell, t) for t in targets))
+        if best is None or score < best[0]:
+            best = (score, dirn)
+    return best[1]
+
+
+def main():
+    import serial
+
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('port')
+    parser.add_argument('--baud', type=int, default=19200)
+    parser.add_argument('--games', type=int, default=10)
+    args = parser.parse_args()
+
+    link = BotLink(serial.Serial(args.port, args.baud, timeout=1))
+    link.set_lockstep(True)
+    link.next_status()
+    for game in range(1, args.games + 1):
+        link.port.write(b'n')
+        while not link.next_status()[2] & STATUS_NEW_GAME:
+            pass
+        # Lockstep mode is turned off at the start of every game
+        link.set_lockstep(True)
+        link.next_status()
+        steps = 0
+        while True:
+            link.send_moves([choose(link.board)])
+            flags = link.next_status()[2]
+            while not flags & STATUS_MOVED:
+                flags = link.next_status()[2]
+            steps += 1
+            if not flags & STATUS_ALIVE:
+                break
+        print('game %d: %d steps, score %d' % (game, steps, link.board.score))
+    link.set_lockstep(False)
+
+
+if __name__ == '__main__':
+    sys.exit(main())
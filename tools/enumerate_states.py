@@ -0,0 +1,226 @@
+#!/usr/bin/env python3
+"""Enumerate every reachable game state on a small board.
+
+    enumerate_states.py [--width W] [--height H] [--food N]
+                        [--max-length L] [--jobs J]
+
+Explores, breadth first, every state reachable from every starting
+position the firmware can choose (see init_snake()) with N food items
+placed anywhere. The rules follow the firmware: the board wraps around,
+the snake can't reverse, it may move into the cell its tail is leaving,
+eating grows it (up to the maximum length) and eaten food reappears on
+any free cell, each choice being a separate successor state. The rat and
+super food are left out; the rat's movement only depends on the cells
+around it and is checked separately, for every cell and every
+combination of blocked neighbours.
+
+Each state is packed into one integer (length, head cell, the direction
+of each body segment in 2 bits, and a bit mask of food cells) which
+serves as its canonical form. Each layer of the search is split across
+worker processes (--jobs).
+
+Reports the number of states, snake deaths, states where some food
+can't be reached from the head (treating the tail as free), whether the
+rat can get stuck or leave the board, states per second and peak memory.
+"""
+
+import argparse
+import multiprocessing
+import resource
+import time
+
+# Directions as (dx, dy), in SnakeDirnType order: up, right, down, left
+DIRECTIONS = ((0, 1), (1, 0), (0, -1), (-1, 0))
+
+
+class Rules:
+    def __init__(self, width, height, max_length):
+        self.width = width
+        self.height = height
+        self.cells = width * height
+        self.max_length = max_length
+        self.cell_bits = max(1, (self.cells - 1).bit_length())
+        # neighbour[cell][dirn], wrapping around the edges
+        self.neighbour = [[((c // height + dx) % width) * height +
+                           (c % height + dy) % height
+                           for dx, dy in DIRECTIONS]
+                          for c in range(self.cells)]
+
+    def encode(self, snake, food):
+        """Pack a snake (tuple of cells, head first) and food mask."""
+        code = len(snake)
+        code = (code << self.cell_bits) | snake[0]
+        for i in range(1, len(snake)):
+            code = (code << 2) | self.neighbour[snake[i - 1]].index(snake[i])
+        return (code << self.cells) | food
+
+    def decode(self, code):
+        food = code & ((1 << self.cells) - 1)
+        code >>= self.cells
+        # The length is in the top bits, so find it by trying each length
+        for length in range(1, self.max_length + 1):
+            rest = code >> (2 * (length - 1) + self.cell_bits)
+            if rest == length:
+                break
+        dirns = code & ((1 << (2 * (length - 1))) - 1)
+        snake = [(code >> (2 * (length - 1))) & ((1 << self.cell_bits) - 1)]
+        for i in range(length - 2, -1, -1):
+            snake.append(self.neighbour[snake[-1]][(dirns >> (2 * i)) & 3])
+        return tuple(snake), food
+
+    def starts(self, num_food):
+        """Yield the starting states (as in init_snake())."""
+        for x in range(self.width - 3):
+            for y in range(self.height - 2):
+                tail = (x + 1) * self.height + y + 1
+                snake = (tail + self.height, tail)
+                free = [c for c in range(self.cells) if c not in snake]
+                for food in food_masks(free, num_food):
+                    yield self.encode(snake, food)
+
+    def successors(self, code):
+        """Return (successor codes, deaths) for a state."""
+        snake, food = self.decode(code)
+        head = snake[0]
+        neck = snake[1] if len(snake) > 1 else None
+        body = set(snake[:-1])
+        result = []
+        deaths = 0
+        for dirn in range(4):
+            cell = self.neighbour[head][dirn]
+            if cell == neck:
+                continue            # can't reverse
+            if cell in body:
+                deaths += 1
+                continue
+            if food >> cell & 1:
+                grown = len(snake) < self.max_length
+                moved = (cell,) + (snake if grown else snake[:-1])
+                remaining = food & ~(1 << cell)
+                occupied = set(moved)
+                free = [c for c in range(self.cells)
+                        if c not in occupied and not remaining >> c & 1]
+                if not free:
+                    result.append(self.encode(moved, remaining))
+                for c in free:
+                    result.append(self.encode(moved, remaining | 1 << c))
+            else:
+                result.append(self.encode((cell,) + snake[:-1], food))
+        return result, deaths
+
+    def food_unreachable(self, code):
+        """True if some food can't be reached from the head."""
+        snake, food = self.decode(code)
+        blocked = set(snake[1:-1])
+        seen = {snake[0]}
+        frontier = [snake[0]]
+        while frontier:
+            cell = frontier.pop()
+            for n in self.neighbour[cell]:
+                if n not in seen and n not in blocked:
+                    seen.add(n)
+                    frontier.append(n)
+        return any(food >> c & 1 and c not in seen for c in range(self.cells))
+
+
+def food_masks(free, count):
+    """Yield every way of putting count food items on the free cells."""
+    if count == 0:
+        yield 0
+        return
+    for i, cell in enumerate(free):
+        for rest in food_masks(free[i + 1:], count - 1):
+            yield rest | 1 << cell
+
+
+def rat_moves(width, height, x, y):
+    """Cells the rat can try to move to (as in next_rat_pos())."""
+    return [(x + 1 if x == 0 else x - 1, y),
+            (x - 1 if x == width - 1 else x + 1, y),
+            (x, y - 1 if y == height - 1 else y + 1),
+            (x, y + 1 if y == 0 else y - 1)]
+
+
+def check_rat(width, height):
+    """Return (fewest different cells the rat can try from any cell,
+    number of tries that would take it off the board).
+
+    The rat is stuck (next_rat_pos() gives up) when every cell it can try
+    is blocked, so the fewer there are the easier it is to box in.
+    """
+    fewest = 4
+    off_board = 0
+    for x in range(width):
+        for y in range(height):
+            moves = rat_moves(width, height, x, y)
+            off_board += sum(not (0 <= mx < width and 0 <= my < height)
+                             for mx, my in moves)
+            fewest = min(fewest, len(set(moves) - {(x, y)}))
+    return fewest, off_board
+
+
+_rules = None
+
+
+def _init_worker(rules):
+    global _rules
+    _rules = rules
+
+
+def _expand(chunk):
+    successors = set()
+    deaths = 0
+    unreachable = 0
+    for code in chunk:
+        states, died = _rules.successors(code)
+        successors.update(states)
+        deaths += died
+        unreachable += _rules.food_unreachable(code)
+    return successors, deaths, unreachable
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('--width', type=int, default=4)
+    parser.add_argument('--height', type=int, default=4)
+    parser.add_argument('--food', type=int, default=1)
+    parser.add_argument('--max-length', type=int, default=32)
+    parser.add_argument('--jobs', type=int, default=multiprocessing.cpu_count())
+    args = parser.parse_args()
+
+    rules = Rules(args.width, args.height,
+                  min(args.max_length, args.width * args.height))
+    start_time = time.time()
+    visited = set(rules.starts(args.food))
+    frontier = list(visited)
+    deaths = unreachable = layers = 0
+    with multiprocessing.Pool(args.jobs, _init_worker, (rules,)) as pool:
+        while frontier:
+            size = max(1, len(frontier) // (4 * args.jobs))
+            chunks = [frontier[i:i + size]
+                      for i in range(0, len(frontier), size)]
+            frontier = []
+            for successors, died, blocked in pool.imap_unordered(_expand, chunks):
+                deaths += died
+                unreachable += blocked
+                successors -= visited
+                visited |= successors
+                frontier.extend(successors)
+            layers += 1
+    elapsed = time.time() - start_time
+
+    fewest, off_board = check_rat(args.width, args.height)
+    print('board %dx%d, %d food, maximum length %d' % (
+        args.width, args.height, args.food, rules.max_length))
+    print('%d states in %d layers, %d moves into the snake' % (
+        len(visited), layers, deaths))
+    print('%d states with food the snake cannot reach' % unreachable)
+    print('rat: boxed in by as few as %d blocked cells, %d moves off the board' % (
+        fewest, off_board))
+    print('%.0f states/s, peak memory (main process) %d KB' % (
+        len(visited) / elapsed if elapsed else 0,
+        resource.getrusage(resource.RUSAGE_SELF).ru_maxrss))
+
+
+if __name__ == '__main__':
+    main()
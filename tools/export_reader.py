@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""Convert and read the training data exported by the snake firmware.
+
+With exporting switched on ('x'), the firmware streams one fixed-size
+(state, action, reward) record per snake move inside ANSI application
+program command strings (ESC _ X <hex> ESC \\, or ESC _ Z for zero run
+length encoded records) mixed into its normal terminal output. See
+exporter.h for the record layout.
+
+    export_reader.py <serial capture> <output file>
+
+collects the records from a capture into a file of back to back records
+after an 8 byte header ("SNKX" and the record count). The file can then
+be opened with ExportFile, which maps it into memory and hands out
+records and random mini-batches as views into the mapping, without
+copying.
+"""
+
+import mmap
+import random
+import re
+import struct
+import sys
+
+CHUNK = re.compile(rb'\x1b_([XZ])([0-9A-F]*)\x1b\\')
+RECORD_SIZE = 38
+HEADER = struct.Struct('<4sI')
+MAGIC = b'SNKX'
+REWARD_DIED = -128
+
+
+def decompress(data):
+    """Expand the zero runs of a compressed record."""
+    out = bytearray()
+    pos = 0
+    while pos < len(data):
+        if data[pos] == 0:
+            out += bytes(data[pos + 1])
+            pos += 2
+        else:
+            out.append(data[pos])
+            pos += 1
+    return bytes(out)
+
+
+def capture_records(capture):
+    """Yield each record in a serial capture."""
+    for kind, chunk in CHUNK.findall(capture):
+        record = bytes.fromhex(chunk.decode())
+        if kind == b'Z':
+            record = decompress(record)
+        if len(record) == RECORD_SIZE:
+            yield record
+
+
+def bitboard_cells(plane):
+    """Return the (x, y) cells set in a 16 byte bitboard plane."""
+    return [(x, y) for y in range(len(plane) // 2)
+            for x in range(16) if plane[2 * y + x // 8] >> (x % 8) & 1]
+
+
+class ExportFile:
+    """A converted export file, mapped into memory."""
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.map = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        magic, self.count = HEADER.unpack_from(self.map)
+        if magic != MAGIC:
+            raise ValueError('%s is not an export file' % path)
+        self.view = memoryview(self.map)[HEADER.size:]
+
+    def __len__(self):
+        return self.count
+
+    def record(self, index):
+        """Return a view of one record."""
+        start = index * RECORD_SIZE
+        return self.view[start:start + RECORD_SIZE]
+
+    def minibatch(self, size, rng=random):
+        """Return views of size randomly chosen records."""
+        return [self.record(rng.randrange(self.count)) for _ in range(size)]
+
+    @staticmethod
+    def fields(record):
+        """Split a record into its named fields."""
+        reward = record[37] - 256 if record[37] >= 128 else record[37]
+        return {
+            'snake': record[0:16], 'food': record[16:32],
+            'head': record[32], 'super_food': record[33],
+            'rat': record[34], 'direction': record[35],
+            'action': record[36], 'reward': reward,
+        }
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit('usage: %s <serial capture> <output file>' % sys.argv[0])
+    with open(sys.argv[1], 'rb') as capture:
+        records = list(capture_records(capture.read()))
+    with open(sys.argv[2], 'wb') as out:
+        out.write(HEADER.pack(MAGIC, len(records)))
+        for record in records:
+            out.write(record)
+    print('%d records written' % len(records))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+"""Extract and print the replays recorded by the snake firmware.
+
+The firmware streams each game's replay inside ANSI application program
+command strings (ESC _ R <hex> ESC \\) mixed into its normal terminal
+output. Capture the serial output to a file (e.g. with a terminal
+program's logging option) and pass it to this script. See replay.h for
+the record format.
+
+Keyframes (full game state snapshots written every few snake steps) are
+printed in full so that a game can be picked up part way through.
+"""
+
+import re
+import sys
+
+CHUNK = re.compile(rb'\x1b_R([0-9A-F]*)\x1b\\')
+
+# Event code -> (name, number of argument bytes)
+EVENTS = {
+    0x04: ('escape', 1),
+    0x05: ('key', 1),
+    0x06: ('controller', 1),
+    0x07: ('seed', 4),
+    0x08: ('joystick', 1),
+    0x09: ('bot move', 1),
+    0x0A: ('controller move', 1),
+    0x10: ('snake step', 0),
+    0x11: ('rat step', 0),
+    0x12: ('super food', 0),
+    0x18: ('keyframe', None),
+    0x1F: ('end', 0),
+}
+
+
+def keyframe_length(data, pos):
+    """Return the length of the keyframe starting at data[pos]."""
+    snake_length = data[pos]
+    num_food = data[pos + snake_length + 3]
+    return snake_length + num_food + 16
+
+
+def keyframe(args):
+    """Describe the game state held in a keyframe."""
+    def cell(posn):
+        return '(%d,%d)' % (posn >> 4, posn & 0x0F)
+    snake_length = args[0]
+    snake = args[1:1 + snake_length]
+    pos = 1 + snake_length
+    dirn = 'URDL'[args[pos]]
+    next_dirn = 'URDL'[args[pos + 1]]
+    food = args[pos + 3:pos + 3 + args[pos + 2]]
+    pos += 3 + len(food)
+    rat, super_food = args[pos], args[pos + 1]
+    score = int.from_bytes(args[pos + 2:pos + 6], 'little')
+    delay = int.from_bytes(args[pos + 6:pos + 8], 'little')
+    state = int.from_bytes(args[pos + 8:pos + 12], 'little')
+    return ('snake %s moving %s (next %s), food %s, rat %s, super food %s, '
+            'score %d, delay %d, random state %d' % (
+                ' '.join(cell(p) for p in snake), dirn, next_dirn,
+                ' '.join(cell(p) for p in food), cell(rat),
+                cell(super_food) if not super_food & 0x08 else 'none',
+                score, delay, state))
+
+
+def records(data):
+    """Yield (time, name, args) for every record in the byte stream."""
+    pos = 0
+    time = 0
+    while pos < len(data):
+        delta = 0
+        shift = 0
+        while True:
+            byte = data[pos]
+            pos += 1
+            delta |= (byte & 0x7F) << shift
+            shift += 7
+            if not byte & 0x80:
+                break
+        code = data[pos]
+        pos += 1
+        if code < 0x04:
+            name, length = 'button %d' % code, 0
+        else:
+            name, length = EVENTS.get(code, ('unknown 0x%02X' % code, 0))
+        if length is None:
+            length = keyframe_length(data, pos)
+        args = data[pos:pos + length]
+        pos += length
+        time = 0 if name == 'seed' else time + delta
+        yield time, name, args
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit('usage: %s <serial capture>' % sys.argv[0])
+    with open(sys.argv[1], 'rb') as capture:
+        data = b''.join(bytes.fromhex(chunk.decode())
+                        for chunk in CHUNK.findall(capture.read()))
+    for time, name, args in records(data):
+        if name == 'seed':
+            print('--- game, seed %d' % int.from_bytes(args, 'little'))
+        elif name == 'keyframe':
+            print('%8d ms  keyframe: %s' % (time, keyframe(args)))
+        elif name in ('escape', 'key'):
+            print('%8d ms  %s %r' % (time, name, chr(args[0])))
+        elif args:
+            print('%8d ms  %s %d' % (time, name, args[0]))
+        else:
+            print('%8d ms  %s' % (time, name))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,467 @@
+/*
+ * broadcast.c
+ *
+ * Written by Hans Song
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "broadcast.h"
+
+/* Decoder states */
+#define STATE_GROUND	0
+#define STATE_ESCAPE	1		/* had ESC */
+#define STATE_CSI		2		/* had ESC [ */
+#define STATE_STRING	3		/* in ESC _ (or ESC P, ESC ], ESC ^) ... ESC \ */
+#define STATE_STRING_ESCAPE 4	/* had ESC in a string */
+#define STATE_FRAME		5		/* in a frame (see frame.h) */
+
+#define FRAME_SYNC		0xA5
+#define CANCEL			0x18	/* abandons any escape sequence the terminal is in */
+
+/* Telemetry (see telemetry.h) */
+#define TELEMETRY_KEYFRAME	0x01
+#define TELEMETRY_STEP		0x02
+#define TELEMETRY_ITEM		0x03
+#define TELEMETRY_END		0x04
+#define TELEMETRY_FOOD		0x00
+#define TELEMETRY_SUPER_FOOD 0x01
+#define TELEMETRY_RAT		0x02
+#define TELEMETRY_REMOVED	0x80
+#define INVALID_POSITION	0x08
+
+/* Cell attributes, and the display parameters that set them */
+static const uint8_t attribute_parameters[] = {1, 2, 4, 5, 7, 8};
+#define NUM_ATTRIBUTES (sizeof(attribute_parameters))
+
+Chunk* chunk_new(const uint8_t* data, size_t length) {
+	Chunk* chunk = malloc(sizeof(Chunk) + length);
+	if(chunk) {
+		chunk->refs = 1;
+		chunk->length = length;
+		memcpy(chunk->data, data, length);
+	}
+	return chunk;
+}
+
+void chunk_ref(Chunk* chunk) {
+	chunk->refs++;
+}
+
+void chunk_unref(Chunk* chunk) {
+	if(--chunk->refs == 0) {
+		free(chunk);
+	}
+}
+
+void queue_clear(ChunkQueue* queue) {
+	while(queue->count) {
+		chunk_unref(queue->chunks[queue->first]);
+		queue->first = (queue->first + 1) % QUEUE_MAX_CHUNKS;
+		queue->count--;
+	}
+	queue->offset = 0;
+	queue->bytes = 0;
+}
+
+int queue_push(ChunkQueue* queue, Chunk* chunk) {
+	/* (An empty queue takes anything, however big) */
+	if(queue->count && (queue->count == QUEUE_MAX_CHUNKS ||
+			queue->bytes + chunk->length > QUEUE_MAX_BYTES)) {
+		queue_clear(queue);
+		return -1;
+	}
+	chunk_ref(chunk);
+	queue->chunks[(queue->first + queue->count++) % QUEUE_MAX_CHUNKS] = chunk;
+	queue->bytes += chunk->length;
+	return 0;
+}
+
+int queue_send(ChunkQueue* queue, int fd) {
+	struct iovec iov[QUEUE_MAX_CHUNKS];
+	struct msghdr message = {.msg_iov = iov};
+	ssize_t sent;
+
+	while(queue->count) {
+		for(int i = 0; i < queue->count; i++) {
+			Chunk* chunk = queue->chunks[(queue->first + i) % QUEUE_MAX_CHUNKS];
+			size_t skip = (i == 0) ? queue->offset : 0;
+			iov[i].iov_base = chunk->data + skip;
+			iov[i].iov_len = chunk->length - skip;
+		}
+		message.msg_iovlen = queue->count;
+		sent = sendmsg(fd, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if(sent < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+		}
+		queue->bytes -= sent;
+		/* Drop the chunks that have gone completely */
+		sent += queue->offset;
+		while(queue->count &&
+				(size_t)sent >= queue->chunks[queue->first]->length) {
+			sent -= queue->chunks[queue->first]->length;
+			chunk_unref(queue->chunks[queue->first]);
+			queue->first = (queue->first + 1) % QUEUE_MAX_CHUNKS;
+			queue->count--;
+		}
+		queue->offset = sent;
+	}
+	return 0;
+}
+
+static const Cell blank = {' ', 0, 0, 0};
+
+static void clear_cells(Mirror* mirror, int row, int column, int end_row) {
+	for(; row <= end_row; row++) {
+		for(; column < SCREEN_COLUMNS; column++) {
+			mirror->cells[row][column] = blank;
+		}
+		column = 0;
+	}
+}
+
+void mirror_init(Mirror* mirror) {
+	memset(mirror, 0, sizeof(Mirror));
+	clear_cells(mirror, 0, 0, SCREEN_ROWS - 1);
+	mirror->pen = blank;
+	mirror->rat = mirror->super_food = INVALID_POSITION;
+}
+
+static void set_display_parameter(Cell* pen, int parameter) {
+	if(parameter == 0) {
+		*pen = blank;
+	} else if(parameter >= 30 && parameter <= 37) {
+		pen->foreground = parameter;
+	} else if(parameter == 39) {
+		pen->foreground = 0;
+	} else if(parameter >= 40 && parameter <= 47) {
+		pen->background = parameter;
+	} else if(parameter == 49) {
+		pen->background = 0;
+	} else {
+		for(size_t i = 0; i < NUM_ATTRIBUTES; i++) {
+			if(attribute_parameters[i] == parameter) {
+				pen->attributes |= 1 << i;
+			}
+		}
+	}
+}
+
+static int clamp(int value, int limit) {
+	return value < 0 ? 0 : (value >= limit ? limit - 1 : value);
+}
+
+/* Carry out a control sequence (ESC [ parameters final) */
+static void control_sequence(Mirror* mirror, uint8_t final) {
+	int first = mirror->num_parameters ? mirror->parameters[0] : 0;
+	int count = first ? first : 1;
+
+	switch(final) {
+		case 'H':
+		case 'f':
+			mirror->row = clamp(first - 1, SCREEN_ROWS);
+			mirror->column = clamp((mirror->num_parameters > 1 ?
+					mirror->parameters[1] : 1) - 1, SCREEN_COLUMNS);
+			break;
+		case 'A':
+			mirror->row = clamp(mirror->row - count, SCREEN_ROWS);
+			break;
+		case 'B':
+			mirror->row = clamp(mirror->row + count, SCREEN_ROWS);
+			break;
+		case 'C':
+			mirror->column = clamp(mirror->column + count, SCREEN_COLUMNS);
+			break;
+		case 'D':
+			mirror->column = clamp(mirror->column - count, SCREEN_COLUMNS);
+			break;
+		case 'J':
+			if(first == 2) {
+				clear_cells(mirror, 0, 0, SCREEN_ROWS - 1);
+			} else if(first == 0) {
+				clear_cells(mirror, mirror->row, mirror->column, SCREEN_ROWS - 1);
+			}
+			break;
+		case 'K':
+			clear_cells(mirror, mirror->row, mirror->column, mirror->row);
+			break;
+		case 'm':
+			if(mirror->num_parameters == 0) {
+				mirror->pen = blank;
+			}
+			for(int i = 0; i < mirror->num_parameters; i++) {
+				set_display_parameter(&mirror->pen, mirror->parameters[i]);
+			}
+			break;
+		/* Anything else (scroll regions, showing and hiding the cursor)
+		 * doesn't change what is on the screen
+		 */
+	}
+}
+
+/* Scores are sent least significant byte first */
+static uint32_t get_score(const uint8_t* data) {
+	return data[0] | (data[1] << 8) | ((uint32_t)data[2] << 16) |
+			((uint32_t)data[3] << 24);
+}
+
+static void telemetry_frame(Mirror* mirror, uint8_t type, const uint8_t* payload,
+		int length) {
+	if(type == TELEMETRY_KEYFRAME && length >= 1) {
+		int snake_length = payload[0];
+		int pos = 1 + snake_length;
+		if(length < pos + 1 || length < pos + 1 + payload[pos] + 6) {
+			return;
+		}
+		mirror->snake_first = 0;
+		mirror->snake_length = snake_length;
+		memcpy(mirror->snake, payload + 1, snake_length);
+		mirror->num_food = payload[pos] < sizeof(mirror->food) ?
+				payload[pos] : sizeof(mirror->food);
+		memcpy(mirror->food, payload + pos + 1, mirror->num_food);
+		pos += 1 + payload[pos];
+		mirror->rat = payload[pos];
+		mirror->super_food = payload[pos + 1];
+		mirror->score = get_score(payload + pos + 2);
+		mirror->have_board = 1;
+	} else if(type == TELEMETRY_STEP && length == 4) {
+		uint8_t head = payload[0];
+		mirror->snake[(uint8_t)(mirror->snake_first + mirror->snake_length++)] = head;
+		if(payload[1] != INVALID_POSITION && mirror->snake_length) {
+			mirror->snake_first++;
+			mirror->snake_length--;
+		}
+		for(int i = 0; i < mirror->num_food; i++) {
+			if(mirror->food[i] == head) {
+				mirror->food[i] = mirror->food[--mirror->num_food];
+				break;
+			}
+		}
+		mirror->score += payload[2];
+	} else if(type == TELEMETRY_ITEM && length == 2) {
+		uint8_t item = payload[0] & ~TELEMETRY_REMOVED;
+		int removed = payload[0] & TELEMETRY_REMOVED;
+		if(item == TELEMETRY_FOOD) {
+			for(int i = 0; i < mirror->num_food; i++) {
+				if(mirror->food[i] == payload[1]) {
+					mirror->food[i] = mirror->food[--mirror->num_food];
+					break;
+				}
+			}
+			if(!removed && mirror->num_food < (int)sizeof(mirror->food)) {
+				mirror->food[mirror->num_food++] = payload[1];
+			}
+		} else if(item == TELEMETRY_SUPER_FOOD) {
+			mirror->super_food = removed ? INVALID_POSITION : payload[1];
+		} else if(item == TELEMETRY_RAT) {
+			mirror->rat = removed ? INVALID_POSITION : payload[1];
+		}
+	} else if(type == TELEMETRY_END && length >= 4) {
+		mirror->score = get_score(payload);
+	}
+}
+
+static uint8_t crc8(const uint8_t* data, int length) {
+	uint8_t crc = 0;
+	while(length--) {
+		crc ^= *data++;
+		for(int i = 0; i < 8; i++) {
+			crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+		}
+	}
+	return crc;
+}
+
+void mirror_feed(Mirror* mirror, const uint8_t* data, size_t length) {
+	while(length--) {
+		uint8_t c = *data++;
+		switch(mirror->state) {
+			case STATE_GROUND:
+				if(c == 0x1b) {
+					mirror->state = STATE_ESCAPE;
+				} else if(c == FRAME_SYNC) {
+					mirror->state = STATE_FRAME;
+					mirror->frame_length = 0;
+				} else if(c == '\r') {
+					mirror->column = 0;
+				} else if(c == '\n') {
+					mirror->row = clamp(mirror->row + 1, SCREEN_ROWS);
+				} else if(c == '\b') {
+					mirror->column = clamp(mirror->column - 1, SCREEN_COLUMNS);
+				} else if(c >= 0x20 && c < 0x7F && mirror->column < SCREEN_COLUMNS) {
+					Cell* cell = &mirror->cells[mirror->row][mirror->column++];
+					*cell = mirror->pen;
+					cell->character = c;
+				}
+				break;
+			case STATE_ESCAPE:
+				if(c == '[') {
+					mirror->state = STATE_CSI;
+					mirror->num_parameters = 0;
+				} else if(c == '_' || c == 'P' || c == ']' || c == '^') {
+					mirror->state = STATE_STRING;
+				} else {
+					/* Two character sequence (e.g. scrolling) - ignored */
+					mirror->state = STATE_GROUND;
+				}
+				break;
+			case STATE_CSI:
+				if(c >= '0' && c <= '9') {
+					if(mirror->num_parameters == 0) {
+						mirror->parameters[mirror->num_parameters++] = 0;
+					}
+					int* parameter = &mirror->parameters[mirror->num_parameters - 1];
+					if(*parameter < 1000) {
+						*parameter = *parameter * 10 + (c - '0');
+					}
+				} else if(c == ';') {
+					if(mirror->num_parameters == 0) {
+						mirror->parameters[mirror->num_parameters++] = 0;
+					}
+					if(mirror->num_parameters < 8) {
+						mirror->parameters[mirror->num_parameters++] = 0;
+					}
+				} else if(c >= 0x40 && c <= 0x7E) {
+					control_sequence(mirror, c);
+					mirror->state = STATE_GROUND;
+				} else if(c < 0x20 || c > 0x3F) {
+					mirror->state = STATE_GROUND;
+				}
+				/* (other parameter bytes, such as ?, are skipped) */
+				break;
+			case STATE_STRING:
+				if(c == 0x1b) {
+					mirror->state = STATE_STRING_ESCAPE;
+				}
+				break;
+			case STATE_STRING_ESCAPE:
+				mirror->state = (c == '\\') ? STATE_GROUND : STATE_STRING;
+				break;
+			case STATE_FRAME:
+				mirror->frame[mirror->frame_length++] = c;
+				if(mirror->frame_length >= 2 &&
+						mirror->frame_length == mirror->frame[1] + 3) {
+					if(crc8(mirror->frame, mirror->frame_length - 1) == c) {
+						telemetry_frame(mirror, mirror->frame[0], mirror->frame + 2,
+								mirror->frame[1]);
+					}
+					mirror->state = STATE_GROUND;
+				}
+				break;
+		}
+	}
+}
+
+int mirror_at_boundary(const Mirror* mirror) {
+	return mirror->state == STATE_GROUND;
+}
+
+/* Growable buffer for building a keyframe */
+typedef struct {
+	uint8_t* data;
+	size_t length, size;
+} Buffer;
+
+static void put(Buffer* buffer, const void* data, size_t length) {
+	if(buffer->length + length > buffer->size) {
+		buffer->size = (buffer->length + length) * 2;
+		buffer->data = realloc(buffer->data, buffer->size);
+	}
+	memcpy(buffer->data + buffer->length, data, length);
+	buffer->length += length;
+}
+
+static void put_byte(Buffer* buffer, uint8_t byte) {
+	put(buffer, &byte, 1);
+}
+
+static void put_text(Buffer* buffer, const char* format, int a, int b) {
+	char text[32];
+	put(buffer, text, snprintf(text, sizeof(text), format, a, b));
+}
+
+static void put_pen(Buffer* buffer, const Cell* pen) {
+	put_text(buffer, "\x1b[0", 0, 0);
+	for(size_t i = 0; i < NUM_ATTRIBUTES; i++) {
+		if(pen->attributes & (1 << i)) {
+			put_text(buffer, ";%d", attribute_parameters[i], 0);
+		}
+	}
+	if(pen->foreground) {
+		put_text(buffer, ";%d", pen->foreground, 0);
+	}
+	if(pen->background) {
+		put_text(buffer, ";%d", pen->background, 0);
+	}
+	put_byte(buffer, 'm');
+}
+
+static int same_pen(const Cell* a, const Cell* b) {
+	return a->attributes == b->attributes && a->foreground == b->foreground &&
+			a->background == b->background;
+}
+
+Chunk* mirror_keyframe(const Mirror* mirror) {
+	Buffer buffer = {NULL, 0, 0};
+	Cell pen = blank;
+
+	put_byte(&buffer, CANCEL);
+	put_text(&buffer, "\x1b[0m\x1b[2J", 0, 0);
+	for(int row = 0; row < SCREEN_ROWS; row++) {
+		int end = SCREEN_COLUMNS;
+		while(end > 0 && mirror->cells[row][end - 1].character == ' ' &&
+				same_pen(&mirror->cells[row][end - 1], &blank)) {
+			end--;
+		}
+		if(end == 0) {
+			continue;
+		}
+		put_text(&buffer, "\x1b[%d;1H", row + 1, 0);
+		for(int column = 0; column < end; column++) {
+			const Cell* cell = &mirror->cells[row][column];
+			if(!same_pen(cell, &pen)) {
+				put_pen(&buffer, cell);
+				pen = *cell;
+			}
+			put_byte(&buffer, cell->character);
+		}
+	}
+	put_pen(&buffer, &mirror->pen);
+	put_text(&buffer, "\x1b[%d;%dH", mirror->row + 1, mirror->column + 1);
+
+	if(mirror->have_board) {
+		/* Telemetry keyframe, laid out as the firmware sends it */
+		uint8_t frame[3 + 1 + 256 + 1 + 16 + 2 + 4 + 1];
+		int length = 3;
+		frame[length++] = mirror->snake_length;
+		for(int i = 0; i < mirror->snake_length; i++) {
+			frame[length++] = mirror->snake[(uint8_t)(mirror->snake_first + i)];
+		}
+		frame[length++] = mirror->num_food;
+		memcpy(frame + length, mirror->food, mirror->num_food);
+		length += mirror->num_food;
+		frame[length++] = mirror->rat;
+		frame[length++] = mirror->super_food;
+		for(int i = 0; i < 4; i++) {
+			frame[length++] = mirror->score >> (8 * i);
+		}
+		frame[0] = FRAME_SYNC;
+		frame[1] = TELEMETRY_KEYFRAME;
+		frame[2] = length - 3;
+		frame[length] = crc8(frame + 1, length - 1);
+		put(&buffer, frame, length + 1);
+	}
+
+	Chunk* chunk = chunk_new(buffer.data, buffer.length);
+	free(buffer.data);
+	return chunk;
+}
@@ -0,0 +1,112 @@
+/*
+ * broadcast.h
+ *
+ * Written by Hans Song
+ *
+ * Support for sim_server's spectators - any number of clients watching
+ * the same game.
+ *
+ * What a board sends in each tick is copied once into a reference
+ * counted Chunk, and a reference to it is added to the ChunkQueue of
+ * every spectator of that board. A queue is written out straight from the
+ * shared chunks with one sendmsg() (scatter-gather) call, so there is no
+ * per-spectator copy or encoding.
+ *
+ * A spectator that falls too far behind (more than QUEUE_MAX_BYTES or
+ * QUEUE_MAX_CHUNKS waiting) has its queue thrown away and is sent a
+ * keyframe instead - the whole current screen, plus a telemetry keyframe
+ * (see telemetry.h) if the game is sending telemetry. The keyframe comes
+ * from a Mirror kept for each board: a copy of the terminal screen and
+ * of the telemetry board, updated from everything the board sends.
+ */
+
+#ifndef BROADCAST_H_
+#define BROADCAST_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define QUEUE_MAX_CHUNKS 64
+#define QUEUE_MAX_BYTES 16384
+
+typedef struct {
+	int refs;
+	size_t length;
+	uint8_t data[];
+} Chunk;
+
+/* Make a chunk holding a copy of the data, with one reference. */
+Chunk* chunk_new(const uint8_t* data, size_t length);
+void chunk_ref(Chunk* chunk);
+void chunk_unref(Chunk* chunk);
+
+typedef struct {
+	Chunk* chunks[QUEUE_MAX_CHUNKS];
+	int first, count;
+	size_t offset;				/* already sent from the first chunk */
+	size_t bytes;				/* waiting to be sent */
+} ChunkQueue;
+
+/* Add a reference to the chunk to the end of the queue. Returns 0, or -1
+ * if the queue is now too long - it has been emptied and the caller
+ * should add a keyframe.
+ */
+int queue_push(ChunkQueue* queue, Chunk* chunk);
+
+/* Send as much as the (non-blocking) socket will take. Returns -1 if the
+ * socket has failed.
+ */
+int queue_send(ChunkQueue* queue, int fd);
+
+/* Drop everything waiting. */
+void queue_clear(ChunkQueue* queue);
+
+/* The terminal screen. The firmware doesn't use more than this. */
+#define SCREEN_COLUMNS 80
+#define SCREEN_ROWS 30
+
+typedef struct {
+	uint8_t character;
+	uint8_t attributes;			/* ATTRIBUTE_ bits (see broadcast.c) */
+	uint8_t foreground;			/* 30 to 37, or 0 for the default */
+	uint8_t background;			/* 40 to 47, or 0 for the default */
+} Cell;
+
+typedef struct {
+	/* Screen */
+	Cell cells[SCREEN_ROWS][SCREEN_COLUMNS];
+	Cell pen;					/* attributes for new characters */
+	int row, column;
+	/* Telemetry board */
+	int have_board;				/* a keyframe has been seen */
+	uint8_t snake[256];			/* ring of positions, tail first */
+	uint8_t snake_first, snake_length;
+	uint8_t food[16];
+	int num_food;
+	uint8_t rat, super_food;
+	uint32_t score;
+	/* Decoder state */
+	int state;
+	int parameters[8];
+	int num_parameters;
+	uint8_t frame[260];			/* type, length, payload, CRC */
+	int frame_length;
+} Mirror;
+
+void mirror_init(Mirror* mirror);
+
+/* Update the mirror with data sent by the board. */
+void mirror_feed(Mirror* mirror, const uint8_t* data, size_t length);
+
+/* Returns 1 if the board's output so far doesn't end part way through an
+ * escape sequence, string or frame. A keyframe can only be sent at such a
+ * point.
+ */
+int mirror_at_boundary(const Mirror* mirror);
+
+/* Make a chunk that brings a spectator that has missed some output (or
+ * has just arrived) up to date.
+ */
+Chunk* mirror_keyframe(const Mirror* mirror);
+
+#endif /* BROADCAST_H_ */
@@ -0,0 +1,237 @@
+/*
+ * matrix_emu.c
+ *
+ * Written by Hans Song
+ */
+
+#include <string.h>
+
+#include "matrix_emu.h"
+
+#define SHIFT_RIGHT 0x01
+#define SHIFT_LEFT 0x02
+#define SHIFT_DOWN 0x04
+#define SHIFT_UP 0x08
+
+static const char* command_names[NUM_MATRIX_COMMANDS] = {
+	"update all", "update pixel", "update row", "update column", "shift",
+	"clear"
+};
+
+/* Bytes that follow each command byte */
+static const int payload_length[NUM_MATRIX_COMMANDS] = {
+	MATRIX_COLUMNS * MATRIX_ROWS, 2, 1 + MATRIX_COLUMNS, 1 + MATRIX_ROWS, 1, 0
+};
+
+void matrix_init(MatrixEmu* matrix, uint32_t cpu_frequency) {
+	memset(matrix, 0, sizeof(*matrix));
+	matrix->command = -1;
+	matrix->gap_cycles = (uint64_t)cpu_frequency / 1000 * MATRIX_FRAME_GAP_MS;
+}
+
+static int command_for_byte(uint8_t byte) {
+	switch(byte) {
+		case CMD_UPDATE_ALL:
+			return MATRIX_ALL;
+		case CMD_UPDATE_PIXEL:
+			return MATRIX_PIXEL;
+		case CMD_UPDATE_ROW:
+			return MATRIX_ROW;
+		case CMD_UPDATE_COL:
+			return MATRIX_COL;
+		case CMD_SHIFT_DISPLAY:
+			return MATRIX_SHIFT;
+		case CMD_CLEAR_SCREEN:
+			return MATRIX_CLEAR;
+		default:
+			return -1;
+	}
+}
+
+static void set_pixel(MatrixEmu* matrix, int x, int y, uint8_t colour) {
+	if(matrix->pixels[x][y] == colour) {
+		matrix->unchanged++;
+	}
+	matrix->pixels[x][y] = colour;
+}
+
+/* Move the display in the given direction(s). Pixels moved off the edge
+ * are lost and the row or column moved in is blank.
+ */
+static void shift(MatrixEmu* matrix, uint8_t direction) {
+	uint8_t old[MATRIX_COLUMNS][MATRIX_ROWS];
+	int dx = 0, dy = 0;
+
+	if(direction & SHIFT_RIGHT) {
+		dx = 1;
+	} else if(direction & SHIFT_LEFT) {
+		dx = -1;
+	}
+	if(direction & SHIFT_UP) {
+		dy = 1;
+	} else if(direction & SHIFT_DOWN) {
+		dy = -1;
+	}
+	memcpy(old, matrix->pixels, sizeof(old));
+	for(int x = 0; x < MATRIX_COLUMNS; x++) {
+		for(int y = 0; y < MATRIX_ROWS; y++) {
+			int from_x = x - dx, from_y = y - dy;
+			if(from_x < 0 || from_x >= MATRIX_COLUMNS || from_y < 0 ||
+					from_y >= MATRIX_ROWS) {
+				matrix->pixels[x][y] = 0;
+			} else {
+				matrix->pixels[x][y] = old[from_x][from_y];
+			}
+		}
+	}
+}
+
+/* Deal with the byte of the current command's payload at matrix->index
+ * (from 0). Returns 0 if the byte is invalid.
+ */
+static int payload_byte(MatrixEmu* matrix, uint8_t byte) {
+	int index = matrix->index;
+
+	switch(matrix->command) {
+		case MATRIX_ALL:
+			// Sent a row at a time, from row 0
+			set_pixel(matrix, index % MATRIX_COLUMNS, index / MATRIX_COLUMNS, byte);
+			return 1;
+		case MATRIX_PIXEL:
+			if(index == 0) {
+				// Row in the top 4 bits, column in the bottom 4
+				matrix->target = byte;
+				return (byte >> 4) < MATRIX_ROWS;
+			}
+			set_pixel(matrix, matrix->target & 0x0F, matrix->target >> 4, byte);
+			return 1;
+		case MATRIX_ROW:
+			if(index == 0) {
+				matrix->target = byte;
+				return byte < MATRIX_ROWS;
+			}
+			set_pixel(matrix, index - 1, matrix->target, byte);
+			return 1;
+		case MATRIX_COL:
+			if(index == 0) {
+				matrix->target = byte;
+				return byte < MATRIX_COLUMNS;
+			}
+			set_pixel(matrix, matrix->target, index - 1, byte);
+			return 1;
+		case MATRIX_SHIFT:
+			if(byte == 0 || (byte & 0xF0) ||
+					(byte & (SHIFT_LEFT | SHIFT_RIGHT)) == (SHIFT_LEFT | SHIFT_RIGHT) ||
+					(byte & (SHIFT_UP | SHIFT_DOWN)) == (SHIFT_UP | SHIFT_DOWN)) {
+				return 0;
+			}
+			shift(matrix, byte);
+			return 1;
+	}
+	return 0;
+}
+
+int matrix_feed(MatrixEmu* matrix, uint8_t byte, uint64_t cycle) {
+	int new_frame = 0;
+
+	if(matrix->frame_bytes &&
+			cycle - matrix->last_byte_cycle >= matrix->gap_cycles) {
+		matrix_end_frame(matrix);
+		new_frame = 1;
+	}
+	if(matrix->frame_bytes == 0) {
+		memcpy(matrix->frame_start, matrix->pixels, sizeof(matrix->pixels));
+	}
+	matrix->last_byte_cycle = cycle;
+	matrix->bytes++;
+	matrix->frame_bytes++;
+
+	if(matrix->command == -1) {
+		int command = command_for_byte(byte);
+		if(command == -1) {
+			matrix->errors++;
+			return new_frame;
+		}
+		matrix->commands[command]++;
+		matrix->frame_commands++;
+		if(command == MATRIX_CLEAR) {
+			memset(matrix->pixels, 0, sizeof(matrix->pixels));
+			return new_frame;
+		}
+		matrix->command = command;
+		matrix->index = 0;
+		return new_frame;
+	}
+
+	if(!payload_byte(matrix, byte)) {
+		// Drop the rest of the command
+		matrix->errors++;
+		matrix->command = -1;
+	} else if(++matrix->index == payload_length[matrix->command]) {
+		matrix->command = -1;
+	}
+	return new_frame;
+}
+
+void matrix_end_frame(MatrixEmu* matrix) {
+	if(matrix->frame_bytes == 0) {
+		return;
+	}
+	matrix->frames++;
+	if(matrix->frame_bytes > matrix->max_frame_bytes) {
+		matrix->max_frame_bytes = matrix->frame_bytes;
+	}
+	if(matrix->frame_commands > matrix->max_frame_commands) {
+		matrix->max_frame_commands = matrix->frame_commands;
+	}
+	if(memcmp(matrix->frame_start, matrix->pixels, sizeof(matrix->pixels))) {
+		matrix->frames_changed++;
+	}
+	matrix->frame_bytes = 0;
+	matrix->frame_commands = 0;
+}
+
+void matrix_render(const MatrixEmu* matrix, FILE* out) {
+	// Top row (y = 7) first, two characters per pixel. A colour has red in
+	// the bottom 4 bits and green in the top 4 (see pixel_colour.h).
+	for(int y = MATRIX_ROWS - 1; y >= 0; y--) {
+		for(int x = 0; x < MATRIX_COLUMNS; x++) {
+			uint8_t colour = matrix->pixels[x][y];
+			if(colour == 0) {
+				fputs("\x1b[0m .", out);
+			} else {
+				fprintf(out, "\x1b[38;2;%d;%d;0m\xe2\x96\x88\xe2\x96\x88",
+						(colour & 0x0F) * 17, (colour >> 4) * 17);
+			}
+		}
+		fputs("\x1b[0m\x1b[K\n", out);
+	}
+}
+
+void matrix_report(const MatrixEmu* matrix, FILE* out) {
+	uint64_t commands = 0;
+	for(int i = 0; i < NUM_MATRIX_COMMANDS; i++) {
+		commands += matrix->commands[i];
+	}
+	fprintf(out, "LED matrix: %llu bytes, %llu commands, %llu frames "
+			"(%llu changed the display), %llu protocol errors\n",
+			(unsigned long long)matrix->bytes, (unsigned long long)commands,
+			(unsigned long long)matrix->frames,
+			(unsigned long long)matrix->frames_changed,
+			(unsigned long long)matrix->errors);
+	if(matrix->frames) {
+		fprintf(out, "per frame: bytes mean %.1f max %llu, commands mean %.1f "
+				"max %llu\n", matrix->bytes / (double)matrix->frames,
+				(unsigned long long)matrix->max_frame_bytes,
+				commands / (double)matrix->frames,
+				(unsigned long long)matrix->max_frame_commands);
+	}
+	for(int i = 0; i < NUM_MATRIX_COMMANDS; i++) {
+		if(matrix->commands[i]) {
+			fprintf(out, "  %-14s %10llu\n", command_names[i],
+					(unsigned long long)matrix->commands[i]);
+		}
+	}
+	fprintf(out, "  %llu pixels written with the colour they already had\n",
+			(unsigned long long)matrix->unchanged);
+}
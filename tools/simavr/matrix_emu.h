@@ -0,0 +1,87 @@
+/*
+ * matrix_emu.h
+ *
+ * Written by Hans Song
+ *
+ * Host side emulation of the LED matrix board. It is fed the bytes the
+ * firmware sends out of the SPI (everything goes through spi_send_byte(),
+ * see ledmatrix.c), decodes the LED matrix commands exactly as the board
+ * would and keeps its own copy of the 16x8 display.
+ *
+ * It also counts the traffic. The SPI has no notion of a frame, so a frame
+ * is taken to be a burst of bytes: a frame ends when no byte has been sent
+ * for MATRIX_FRAME_GAP_MS. Each game tick (and each step of the splash
+ * screen scroll) is one burst.
+ *
+ * Anything the board couldn't make sense of - an unknown command, or a
+ * row, column or shift that is out of range - is counted as a protocol
+ * error and the decoder waits for the next command.
+ */
+
+#ifndef MATRIX_EMU_H_
+#define MATRIX_EMU_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define MATRIX_COLUMNS 16
+#define MATRIX_ROWS 8
+#define MATRIX_FRAME_GAP_MS 10
+
+/* Commands, as sent by ledmatrix.c */
+#define CMD_UPDATE_ALL 0x00
+#define CMD_UPDATE_PIXEL 0x01
+#define CMD_UPDATE_ROW 0x02
+#define CMD_UPDATE_COL 0x03
+#define CMD_SHIFT_DISPLAY 0x04
+#define CMD_CLEAR_SCREEN 0x0F
+
+typedef enum {
+	MATRIX_ALL, MATRIX_PIXEL, MATRIX_ROW, MATRIX_COL, MATRIX_SHIFT,
+	MATRIX_CLEAR, NUM_MATRIX_COMMANDS
+} MatrixCommand;
+
+typedef struct {
+	uint8_t pixels[MATRIX_COLUMNS][MATRIX_ROWS];	/* [x][y], y = 0 at the bottom */
+
+	/* Decoder state */
+	int command;				/* MatrixCommand, or -1 between commands */
+	int index;					/* bytes of the command received so far */
+	uint8_t target;				/* row, column or pixel position */
+
+	/* Frame timing (in cycles) */
+	uint64_t gap_cycles;
+	uint64_t last_byte_cycle;
+	uint64_t frame_bytes, frame_commands;
+
+	/* Counts */
+	uint64_t bytes;
+	uint64_t commands[NUM_MATRIX_COMMANDS];
+	uint64_t errors;
+	uint64_t unchanged;			/* pixels written with the colour they had */
+	uint64_t frames;
+	uint64_t max_frame_bytes, max_frame_commands;
+	uint64_t frames_changed;	/* frames that left the display different */
+	uint8_t frame_start[MATRIX_COLUMNS][MATRIX_ROWS];
+} MatrixEmu;
+
+/* cpu_frequency is used to turn MATRIX_FRAME_GAP_MS into cycles. */
+void matrix_init(MatrixEmu* matrix, uint32_t cpu_frequency);
+
+/* Decode a byte sent over the SPI at the given cycle. Returns 1 if the
+ * byte started a new frame (i.e. the previous frame has just ended).
+ */
+int matrix_feed(MatrixEmu* matrix, uint8_t byte, uint64_t cycle);
+
+/* End the current frame (if any bytes have been sent in it). */
+void matrix_end_frame(MatrixEmu* matrix);
+
+/* Draw the display on a terminal using ANSI colours, starting at the
+ * cursor position.
+ */
+void matrix_render(const MatrixEmu* matrix, FILE* out);
+
+/* Write a summary of the traffic. */
+void matrix_report(const MatrixEmu* matrix, FILE* out);
+
+#endif /* MATRIX_EMU_H_ */
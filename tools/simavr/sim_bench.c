@@ -0,0 +1,406 @@
+/*
+ * sim_bench.c
+ *
+ * Written by Hans Song
+ *
+ * Runs the snake firmware under simavr (a cycle accurate AVR simulator)
+ * with scripted input and reports how many cycles are spent in chosen
+ * functions and interrupt handlers:
+ *
+ *	sim_bench [-m mcu] [-l] [-p function]... [-b function=cycles]... \
+ *		<firmware.elf> <scenario>
+ *
+ * The scenario is a text file of timed inputs, one per line:
+ *	<ms> key <characters>	characters typed at the terminal (sent over
+ *							the UART at 19200 baud). \e is escape, so
+ *							\e[A is the up cursor key.
+ *	<ms> button <0-3>		push button pressed (and released 50ms later)
+ *	<ms> end				stop the simulation
+ * Lines starting with # are ignored.
+ *
+ * Functions are found by name in the firmware's symbol table (using
+ * avr-nm). A call is timed from the function's first instruction until it
+ * returns to its caller. Time spent in interrupt handlers is left out of
+ * the time of whatever they interrupted, and all interrupt handlers
+ * (__vector_N) are always timed. -p adds a function to the default list
+ * (the game tick functions, ledmatrix_update_pixel and printf_P).
+ *
+ * -b sets a budget: if any call to the function takes longer than that
+ * many cycles, or the function isn't in the symbol table at all, the run
+ * fails (exit status 1), so this can be run as a check on every build.
+ *
+ * Everything sent out of the SPI goes to an emulated LED matrix (see
+ * matrix_emu.h), and the traffic per frame is reported. The run also fails
+ * if the matrix was sent anything it couldn't decode. -l draws the matrix
+ * on the terminal (on stderr) as each frame ends.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include <sim_avr.h>
+#include <sim_elf.h>
+#include <sim_irq.h>
+#include <avr_uart.h>
+#include <avr_ioport.h>
+#include <avr_spi.h>
+
+#include "matrix_emu.h"
+
+#define MAX_FUNCTIONS 64
+#define MAX_DEPTH 32
+#define MAX_EVENTS 256
+
+#define CPU_FREQUENCY 8000000
+#define CYCLES_PER_MS (CPU_FREQUENCY / 1000)
+/* One character at 19200 baud (10 bits) */
+#define CYCLES_PER_CHAR (CPU_FREQUENCY / 1920)
+#define BUTTON_PUSH_MS 50
+
+typedef struct {
+	char name[64];
+	uint32_t address;		/* byte address */
+	uint8_t is_isr;
+	uint64_t calls;
+	uint64_t total;
+	uint64_t max;
+	uint64_t budget;		/* 0 if none */
+} Function;
+
+typedef struct {
+	Function* function;
+	uint64_t start;
+	uint64_t excluded;		/* cycles spent in interrupt handlers */
+	uint32_t return_address;
+	uint16_t return_sp;
+} Frame;
+
+typedef enum {EVENT_KEY, EVENT_BUTTON, EVENT_RELEASE, EVENT_END} EventType;
+
+typedef struct {
+	uint64_t cycle;
+	EventType type;
+	char text[64];
+	int button;
+} Event;
+
+static Function functions[MAX_FUNCTIONS];
+static int num_functions;
+static Frame stack[MAX_DEPTH];
+static int depth;
+static Event events[MAX_EVENTS];
+static int num_events;
+static MatrixEmu matrix;
+static int show_matrix;
+
+static const char* default_functions[] = {
+	"attempt_to_move_snake_forward", "controller_before_move",
+	"ledmatrix_update_pixel", "printf_P", NULL
+};
+
+/* Interrupt vectors used by the firmware (ATmega324A numbering) */
+static const char* vector_name(const char* symbol) {
+	static const struct { const char* symbol; const char* name; } vectors[] = {
+		{"__vector_5", "PCINT1_vect"},
+		{"__vector_13", "TIMER1_COMPA_vect"},
+		{"__vector_16", "TIMER0_COMPA_vect"},
+		{"__vector_20", "USART0_RX_vect"},
+		{"__vector_21", "USART0_UDRE_vect"},
+		{NULL, NULL}
+	};
+	for(int i = 0; vectors[i].symbol; i++) {
+		if(strcmp(vectors[i].symbol, symbol) == 0) {
+			return vectors[i].name;
+		}
+	}
+	return symbol;
+}
+
+static Function* find_function(const char* name) {
+	for(int i = 0; i < num_functions; i++) {
+		if(strcmp(functions[i].name, name) == 0) {
+			return &functions[i];
+		}
+	}
+	return NULL;
+}
+
+static Function* add_function(const char* name) {
+	Function* function = find_function(name);
+	if(!function && num_functions < MAX_FUNCTIONS) {
+		function = &functions[num_functions++];
+		snprintf(function->name, sizeof(function->name), "%s", name);
+		function->address = UINT32_MAX;
+	}
+	return function;
+}
+
+/* Look up the addresses of the functions (and find the interrupt
+ * handlers) with avr-nm.
+ */
+static int read_symbols(const char* elf) {
+	char command[512], line[256], name[200];
+	unsigned address;
+	char type;
+	FILE* nm;
+	
+	snprintf(command, sizeof(command), "avr-nm --defined-only '%s'", elf);
+	if(!(nm = popen(command, "r"))) {
+		return -1;
+	}
+	while(fgets(line, sizeof(line), nm)) {
+		if(sscanf(line, "%x %c %199s", &address, &type, name) != 3 ||
+				(type != 'T' && type != 't')) {
+			continue;
+		}
+		Function* function = strncmp(name, "__vector_", 9) == 0 ?
+				add_function(name) : find_function(name);
+		if(function) {
+			function->address = address;
+			function->is_isr = strncmp(name, "__vector_", 9) == 0;
+		}
+	}
+	return pclose(nm);
+}
+
+static int read_scenario(const char* path) {
+	char line[256], type[16], arg[128];
+	double ms;
+	FILE* file = fopen(path, "r");
+	
+	if(!file) {
+		return -1;
+	}
+	while(fgets(line, sizeof(line), file) && num_events < MAX_EVENTS - 1) {
+		Event* event = &events[num_events];
+		arg[0] = 0;
+		if(line[0] == '#' || sscanf(line, "%lf %15s %127[^\n]", &ms, type, arg) < 2) {
+			continue;
+		}
+		event->cycle = (uint64_t)(ms * CYCLES_PER_MS);
+		if(strcmp(type, "key") == 0) {
+			char* out = event->text;
+			event->type = EVENT_KEY;
+			for(char* in = arg; *in && out < event->text + sizeof(event->text) - 1; in++) {
+				if(in[0] == '\\' && in[1] == 'e') {
+					*out++ = 0x1b;
+					in++;
+				} else {
+					*out++ = *in;
+				}
+			}
+			*out = 0;
+		} else if(strcmp(type, "button") == 0) {
+			event->type = EVENT_BUTTON;
+			event->button = atoi(arg);
+			/* Add the release */
+			events[++num_events] = *event;
+			events[num_events].type = EVENT_RELEASE;
+			events[num_events].cycle += BUTTON_PUSH_MS * CYCLES_PER_MS;
+		} else if(strcmp(type, "end") == 0) {
+			event->type = EVENT_END;
+		} else {
+			fprintf(stderr, "unknown scenario line: %s", line);
+			continue;
+		}
+		num_events++;
+	}
+	fclose(file);
+	return 0;
+}
+
+static uint16_t stack_pointer(avr_t* avr) {
+	return avr->data[R_SPL] | (avr->data[R_SPH] << 8);
+}
+
+/* Called before each instruction: start timing a function if we're at
+ * its first instruction, and stop timing any which have returned.
+ */
+static void profile(avr_t* avr) {
+	uint16_t sp = stack_pointer(avr);
+	
+	while(depth > 0 && avr->pc == stack[depth - 1].return_address &&
+			sp == stack[depth - 1].return_sp) {
+		Frame* frame = &stack[--depth];
+		uint64_t elapsed = avr->cycle - frame->start;
+		uint64_t cycles = elapsed - frame->excluded;
+		Function* function = frame->function;
+		function->calls++;
+		function->total += cycles;
+		if(cycles > function->max) {
+			function->max = cycles;
+		}
+		/* Interrupt handler time is left out of every function the
+		 * handler interrupted, not just the innermost one
+		 */
+		if(depth > 0) {
+			stack[depth - 1].excluded += function->is_isr ? elapsed :
+					frame->excluded;
+		}
+	}
+	for(int i = 0; i < num_functions; i++) {
+		if(functions[i].address == avr->pc && depth < MAX_DEPTH) {
+			/* The return address (a word address, most significant byte
+			 * first) is on top of the stack.
+			 */
+			Frame* frame = &stack[depth++];
+			frame->function = &functions[i];
+			frame->start = avr->cycle;
+			frame->excluded = 0;
+			frame->return_address = ((avr->data[sp + 1] << 8) | avr->data[sp + 2]) * 2;
+			frame->return_sp = sp + 2;
+			break;
+		}
+	}
+}
+
+static void uart_output(struct avr_irq_t* irq, uint32_t value, void* param) {
+	/* The terminal output isn't needed - just count it */
+	(*(uint64_t*)param)++;
+}
+
+static void spi_output(struct avr_irq_t* irq, uint32_t value, void* param) {
+	avr_t* avr = param;
+	if(matrix_feed(&matrix, value, avr->cycle) && show_matrix) {
+		fputs("\x1b[H", stderr);
+		matrix_render(&matrix, stderr);
+	}
+}
+
+int main(int argc, char** argv) {
+	const char* mcu = "atmega324a";
+	elf_firmware_t firmware;
+	avr_t* avr;
+	avr_irq_t* uart_input;
+	avr_irq_t* spi_out;
+	uint64_t uart_bytes = 0, next_char_cycle = 0;
+	const char* pending_keys = "";
+	int next_event = 0, failed = 0, opt;
+	uint32_t flags = 0;
+	
+	for(int i = 0; default_functions[i]; i++) {
+		add_function(default_functions[i]);
+	}
+	while((opt = getopt(argc, argv, "m:lp:b:")) != -1) {
+		if(opt == 'm') {
+			mcu = optarg;
+		} else if(opt == 'l') {
+			show_matrix = 1;
+		} else if(opt == 'p' || opt == 'b') {
+			char* equals = strchr(optarg, '=');
+			Function* function;
+			if(opt == 'b' && equals) {
+				*equals = 0;
+			}
+			if(!(function = add_function(optarg))) {
+				fprintf(stderr, "too many functions (at most %d)\n", MAX_FUNCTIONS);
+				return 2;
+			}
+			if(opt == 'b' && equals) {
+				function->budget = strtoull(equals + 1, NULL, 0);
+			}
+		}
+	}
+	if(argc - optind != 2) {
+		fprintf(stderr, "usage: %s [-m mcu] [-l] [-p function]... "
+				"[-b function=cycles]... <firmware.elf> <scenario>\n", argv[0]);
+		return 2;
+	}
+	if(read_symbols(argv[optind]) != 0 || read_scenario(argv[optind + 1]) != 0) {
+		fprintf(stderr, "can't read %s or %s\n", argv[optind], argv[optind + 1]);
+		return 2;
+	}
+	
+	memset(&firmware, 0, sizeof(firmware));
+	if(elf_read_firmware(argv[optind], &firmware) != 0 ||
+			!(avr = avr_make_mcu_by_name(mcu))) {
+		fprintf(stderr, "can't load %s for %s\n", argv[optind], mcu);
+		return 2;
+	}
+	avr_init(avr);
+	avr_load_firmware(avr, &firmware);
+	avr->frequency = CPU_FREQUENCY;
+	
+	/* Take over the UART from simavr's own stdout handling */
+	avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+	flags &= ~AVR_UART_FLAG_STDIO;
+	avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+	uart_input = avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_INPUT);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'),
+			UART_IRQ_OUTPUT), uart_output, &uart_bytes);
+	
+	/* The LED matrix is the only thing on the SPI. Some versions of simavr
+	 * name the ATmega324A's SPI '0' and others 0.
+	 */
+	matrix_init(&matrix, CPU_FREQUENCY);
+	spi_out = avr_io_getirq(avr, AVR_IOCTL_SPI_GETIRQ('0'), SPI_IRQ_OUTPUT);
+	if(!spi_out) {
+		spi_out = avr_io_getirq(avr, AVR_IOCTL_SPI_GETIRQ(0), SPI_IRQ_OUTPUT);
+	}
+	if(!spi_out) {
+		fprintf(stderr, "can't find the SPI\n");
+		return 2;
+	}
+	avr_irq_register_notify(spi_out, spi_output, avr);
+	
+	while(1) {
+		if(next_event < num_events && avr->cycle >= events[next_event].cycle) {
+			Event* event = &events[next_event++];
+			if(event->type == EVENT_END) {
+				break;
+			} else if(event->type == EVENT_KEY) {
+				pending_keys = event->text;
+			} else {
+				avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'),
+						event->button), event->type == EVENT_BUTTON);
+			}
+		}
+		if(*pending_keys && avr->cycle >= next_char_cycle) {
+			avr_raise_irq(uart_input, *pending_keys++);
+			next_char_cycle = avr->cycle + CYCLES_PER_CHAR;
+		}
+		profile(avr);
+		int state = avr_run(avr);
+		if(state == cpu_Done || state == cpu_Crashed) {
+			fprintf(stderr, "firmware stopped at cycle %llu\n",
+					(unsigned long long)avr->cycle);
+			break;
+		}
+	}
+	
+	printf("%llu cycles (%.1f ms), %llu bytes sent over the UART\n",
+			(unsigned long long)avr->cycle, avr->cycle / (double)CYCLES_PER_MS,
+			(unsigned long long)uart_bytes);
+	matrix_end_frame(&matrix);
+	if(show_matrix) {
+		fputs("\x1b[H", stderr);
+		matrix_render(&matrix, stderr);
+	}
+	matrix_report(&matrix, stdout);
+	failed |= matrix.errors != 0;
+	printf("%-32s %8s %10s %10s %10s\n", "function", "calls", "mean", "max",
+			"budget");
+	for(int i = 0; i < num_functions; i++) {
+		Function* function = &functions[i];
+		int over = function->budget && function->max > function->budget;
+		if(function->address == UINT32_MAX) {
+			/* A budget that can't be checked (e.g. the name is misspelt
+			 * or the function was inlined) fails the run too */
+			printf("%-32s not found%s\n", function->name,
+					function->budget ? "  BUDGET NOT CHECKED" : "");
+			failed |= function->budget != 0;
+			continue;
+		}
+		printf("%-32s %8llu %10.1f %10llu %10llu%s\n",
+				function->is_isr ? vector_name(function->name) : function->name,
+				(unsigned long long)function->calls,
+				function->calls ? function->total / (double)function->calls : 0.0,
+				(unsigned long long)function->max,
+				(unsigned long long)function->budget, over ? "  OVER BUDGET" : "");
+		failed |= over;
+	}
+	return failed;
+}
@@ -0,0 +1,198 @@
+/*
+ * sim_load.c
+ *
+ * Written by Hans Song
+ *
+ * Load generator for sim_server. Opens a number of client connections,
+ * steers each game with a random cursor key every so often and counts
+ * what comes back:
+ *
+ *	sim_load [-c clients] [-t seconds] [-k key interval ms] \
+ *		<host:port | unix socket path>
+ *
+ * At the end it reports how many clients got a session (and how many
+ * couldn't connect, e.g. because the server's listen backlog was full)
+ * and the bytes received per client per second (mean and lowest). A session that is
+ * running behind real time sends less, so a lowest rate well below the
+ * mean shows the server isn't keeping up with that many sessions.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+
+#define TICK_MS 10
+#define MAX_EVENTS 64
+
+typedef struct {
+	int fd;
+	int connected;
+	uint64_t next_key_ms;
+	uint64_t bytes;
+} Client;
+
+static Client* clients;
+static int num_clients = 100;
+
+static int connect_to(const char* target) {
+	char host[256];
+	const char* colon = strrchr(target, ':');
+	int fd;
+
+	if(!colon) {
+		struct sockaddr_un address = {.sun_family = AF_UNIX};
+		snprintf(address.sun_path, sizeof(address.sun_path), "%s", target);
+		fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		/* EAGAIN here means the server's backlog is full, not that the
+		 * connect is in progress */
+		if(fd >= 0 && connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0 &&
+				errno != EINPROGRESS) {
+			close(fd);
+			return -1;
+		}
+		return fd;
+	}
+
+	struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM};
+	struct addrinfo* address;
+	snprintf(host, sizeof(host), "%.*s", (int)(colon - target), target);
+	if(getaddrinfo(host, colon + 1, &hints, &address) != 0) {
+		return -1;
+	}
+	fd = socket(address->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if(fd >= 0 && connect(fd, address->ai_addr, address->ai_addrlen) != 0 &&
+			errno != EINPROGRESS) {
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(address);
+	return fd;
+}
+
+int main(int argc, char** argv) {
+	struct epoll_event events[MAX_EVENTS];
+	int seconds = 30, key_interval = 500, opt, epoll_fd, timer_fd;
+	uint64_t now_ms = 0, keys = 0;
+	int failed = 0;
+	char buffer[4096];
+
+	while((opt = getopt(argc, argv, "c:t:k:")) != -1) {
+		if(opt == 'c') {
+			num_clients = atoi(optarg);
+		} else if(opt == 't') {
+			seconds = atoi(optarg);
+		} else if(opt == 'k') {
+			key_interval = atoi(optarg);
+		}
+	}
+	if(argc - optind != 1 || num_clients < 1 || key_interval < 1) {
+		fprintf(stderr, "usage: %s [-c clients] [-t seconds] [-k key interval ms] "
+				"<host:port | unix socket path>\n", argv[0]);
+		return 2;
+	}
+
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	clients = calloc(num_clients, sizeof(Client));
+	for(int i = 0; i < num_clients; i++) {
+		Client* client = &clients[i];
+		if((client->fd = connect_to(argv[optind])) < 0) {
+			/* Carry on - how many got through is part of the result */
+			failed++;
+			continue;
+		}
+		/* Spread the key presses out */
+		client->next_key_ms = 1000 + rand() % key_interval;
+		struct epoll_event event = {.events = EPOLLIN | EPOLLOUT, .data.ptr = client};
+		epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client->fd, &event);
+	}
+
+	struct itimerspec period = {
+		.it_interval = {0, TICK_MS * 1000000L},
+		.it_value = {0, TICK_MS * 1000000L}
+	};
+	timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	timerfd_settime(timer_fd, 0, &period, NULL);
+	struct epoll_event timer_event = {.events = EPOLLIN, .data.ptr = NULL};
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &timer_event);
+
+	while(now_ms < seconds * 1000ULL) {
+		int n = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+		for(int i = 0; i < n; i++) {
+			Client* client = events[i].data.ptr;
+			if(!client) {
+				uint64_t ticks;
+				if(read(timer_fd, &ticks, sizeof(ticks)) != sizeof(ticks)) {
+					continue;
+				}
+				now_ms += ticks * TICK_MS;
+				for(int j = 0; j < num_clients; j++) {
+					Client* c = &clients[j];
+					if(c->fd >= 0 && c->connected && now_ms >= c->next_key_ms) {
+						char key[3] = {0x1b, '[', 'A' + rand() % 4};
+						if(send(c->fd, key, sizeof(key), MSG_NOSIGNAL) == sizeof(key)) {
+							keys++;
+						}
+						c->next_key_ms = now_ms + key_interval;
+					}
+				}
+				continue;
+			}
+			if(!client->connected && (events[i].events & (EPOLLOUT | EPOLLERR))) {
+				/* The connect has finished - see whether it worked */
+				int error = 0;
+				socklen_t length = sizeof(error);
+				if(getsockopt(client->fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0 ||
+						error != 0) {
+					epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+					close(client->fd);
+					client->fd = -1;
+					failed++;
+					continue;
+				}
+				/* Only wait for output from now on */
+				struct epoll_event event = {.events = EPOLLIN, .data.ptr = client};
+				epoll_ctl(epoll_fd, EPOLL_CTL_MOD, client->fd, &event);
+				client->connected = 1;
+			}
+			if(events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+				ssize_t received;
+				while((received = recv(client->fd, buffer, sizeof(buffer), 0)) > 0) {
+					client->bytes += received;
+				}
+				if(received == 0 || (received < 0 && errno != EAGAIN)) {
+					epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+					close(client->fd);
+					client->fd = -1;
+				}
+			}
+		}
+	}
+
+	int connected = 0, open = 0;
+	uint64_t total = 0, lowest = UINT64_MAX;
+	for(int i = 0; i < num_clients; i++) {
+		connected += clients[i].connected;
+		open += clients[i].fd >= 0;
+		total += clients[i].bytes;
+		if(clients[i].connected && clients[i].bytes < lowest) {
+			lowest = clients[i].bytes;
+		}
+	}
+	printf("%d clients, %d connected, %d failed to connect, %d still open, "
+			"%llu keys sent\n", num_clients, connected, failed, open,
+			(unsigned long long)keys);
+	if(connected) {
+		printf("bytes per client per second: mean %.1f, lowest %.1f\n",
+				total / (double)connected / seconds, lowest / (double)seconds);
+	}
+	return 0;
+}
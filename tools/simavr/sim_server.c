@@ -0,0 +1,682 @@
+/*
+ * sim_server.c
+ *
+ * Written by Hans Song
+ *
+ * Serves games of snake to network clients, each game being the real
+ * firmware running on its own simulated board under simavr:
+ *
+ *	sim_server [-m mcu] [-p port] [-u socket path] [-n max sessions] \
+ *		[-s spectator port] [-w spectator socket path] <firmware.elf>
+ *
+ * Clients connect over TCP (port 5555 by default) or a Unix socket (if -u
+ * is given) and each gets a new board, which is thrown away when they
+ * disconnect. Bytes from the client are sent to the board's UART at 19200
+ * baud and everything the board sends is passed back unchanged, so a
+ * client sees exactly what a terminal plugged into a real board would:
+ * the ANSI terminal view, or (once 'v' has been pressed) the binary
+ * telemetry frames, and it can drive the game with bot command frames
+ * (see telemetry.h and botlink.h). tools/bot_client.py can be pointed at
+ * a session with e.g. socat. Button 0 is pushed when a board starts, to
+ * get past the splash screen.
+ *
+ * Each session is given a number when it starts (written to standard
+ * error). Spectators connect to port 5556 (or the -w socket), send the
+ * number of the session they want to watch followed by a newline, and are
+ * then sent the screen so far and everything the board sends, until the
+ * session ends. The output is shared between spectators rather than
+ * copied for each one, and a spectator that can't keep up is brought up
+ * to date with a keyframe (see broadcast.h) rather than being allowed to
+ * build up a backlog. Spectators can't steer the game.
+ *
+ * Everything runs in one thread. Sockets are non-blocking and waited on
+ * with epoll, along with a single timer which fires every TICK_MS
+ * milliseconds; each time it fires every board is simulated forward to
+ * the current time. A board whose client isn't keeping up with its
+ * output is left paused until the client catches up, and a board that
+ * falls more than MAX_LAG_MS behind (because the server is overloaded)
+ * skips the time it missed rather than trying to catch up.
+ *
+ * The number of sessions and how close to real time they are running is
+ * written to standard error every STATS_SECONDS seconds. Each board is
+ * simulated cycle by cycle at 8MHz, so how many sessions a core can keep
+ * up with depends on the speed of simavr rather than on the server
+ * (sim_load can be used to measure it).
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <sim_avr.h>
+#include <sim_elf.h>
+#include <sim_irq.h>
+#include <avr_uart.h>
+#include <avr_ioport.h>
+
+#include "broadcast.h"
+
+#define CPU_FREQUENCY 8000000
+#define CYCLES_PER_MS (CPU_FREQUENCY / 1000)
+/* One character at 19200 baud (10 bits) */
+#define CYCLES_PER_CHAR (CPU_FREQUENCY / 1920)
+#define BUTTON_PUSH_MS 50
+#define START_BUTTON_MS 100
+
+#define TICK_MS 10
+#define MAX_LAG_MS 200
+#define STATS_SECONDS 10
+#define MAX_EVENTS 64
+
+/* Per session buffers. A board is paused while OUTPUT_HIGH_WATER bytes
+ * are waiting to go to its client; reading from the client stops while
+ * the input buffer is full.
+ */
+#define INPUT_BUFFER_SIZE 256
+#define OUTPUT_BUFFER_SIZE 8192
+#define OUTPUT_HIGH_WATER 4096
+
+/* Kernel send buffer for spectator sockets, kept small so that a
+ * spectator that isn't keeping up is noticed (see broadcast.h) rather
+ * than having output pile up in the kernel
+ */
+#define SPECTATOR_SEND_BUFFER 16384
+
+typedef enum {
+	HANDLER_LISTENER, HANDLER_SPECTATOR_LISTENER, HANDLER_TIMER,
+	HANDLER_SESSION, HANDLER_SPECTATOR
+} HandlerKind;
+
+/* Everything registered with epoll starts with one of these */
+typedef struct Handler {
+	HandlerKind kind;
+	int fd;							/* -1 once closed */
+	struct Handler* next_closed;
+} Handler;
+
+typedef struct Spectator {
+	Handler handler;
+	uint32_t events;				/* registered with epoll */
+	struct Session* session;		/* being watched (NULL until chosen) */
+	struct Spectator* previous;		/* list of the session's spectators */
+	struct Spectator* next;
+	ChunkQueue queue;
+	int needs_keyframe;
+	int reading;					/* 0 once the spectator has stopped sending */
+	char line[16];					/* session number being received */
+	int line_length;
+} Spectator;
+
+typedef struct Session {
+	Handler handler;
+	int index;						/* in sessions[] */
+	int id;
+	uint32_t events;				/* registered with epoll */
+	avr_t* avr;
+	avr_irq_t* uart_input;
+	avr_irq_t* button;
+	uint64_t target_cycle;			/* simulate up to here */
+	uint64_t next_char_cycle;
+	uint64_t push_cycle;			/* when to push/let go of the button (0 if not due) */
+	uint64_t release_cycle;
+	uint8_t input[INPUT_BUFFER_SIZE];
+	int input_start, input_length;
+	uint8_t output[OUTPUT_BUFFER_SIZE];
+	int output_start, output_length;
+	Mirror mirror;
+	Spectator* spectators;
+} Session;
+
+static const char* mcu = "atmega324a";
+static elf_firmware_t firmware;
+static int epoll_fd;
+static Session** sessions;
+static int num_sessions, max_sessions = 64, next_session_id = 1;
+static int num_spectators;
+
+/* Sessions and spectators are closed straight away but only freed once
+ * the events from the current epoll_wait() have been dealt with, since
+ * some of them may be for one closed while dealing with an earlier one.
+ */
+static Handler* closed_handlers;
+
+/* For the statistics */
+static uint64_t cycles_run, cycles_skipped, sessions_opened, resyncs;
+
+static void uart_output(struct avr_irq_t* irq, uint32_t value, void* param) {
+	Session* session = param;
+	if(session->output_start + session->output_length == OUTPUT_BUFFER_SIZE) {
+		memmove(session->output, session->output + session->output_start,
+				session->output_length);
+		session->output_start = 0;
+	}
+	/* Boards are paused well before this could fill up */
+	if(session->output_length < OUTPUT_BUFFER_SIZE) {
+		session->output[session->output_start + session->output_length++] = value;
+	}
+}
+
+/* Register interest in reading from the client while there is room for
+ * its input, and in writing to it while output is waiting.
+ */
+static void update_events(Session* session) {
+	uint32_t events = EPOLLRDHUP;
+	if(session->input_length < INPUT_BUFFER_SIZE) {
+		events |= EPOLLIN;
+	}
+	if(session->output_length) {
+		events |= EPOLLOUT;
+	}
+	if(events != session->events) {
+		struct epoll_event event = {.events = events, .data.ptr = session};
+		epoll_ctl(epoll_fd, EPOLL_CTL_MOD, session->handler.fd, &event);
+		session->events = events;
+	}
+}
+
+static Session* open_session(int fd) {
+	Session* session = calloc(1, sizeof(Session));
+	uint32_t flags = 0;
+
+	if(!session || !(session->avr = avr_make_mcu_by_name(mcu))) {
+		free(session);
+		return NULL;
+	}
+	session->handler.kind = HANDLER_SESSION;
+	session->handler.fd = fd;
+	session->id = next_session_id++;
+	mirror_init(&session->mirror);
+	avr_init(session->avr);
+	avr_load_firmware(session->avr, &firmware);
+	session->avr->frequency = CPU_FREQUENCY;
+
+	/* Take over the UART from simavr's own stdout handling */
+	avr_ioctl(session->avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+	flags &= ~AVR_UART_FLAG_STDIO;
+	avr_ioctl(session->avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+	session->uart_input = avr_io_getirq(session->avr,
+			AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_INPUT);
+	avr_irq_register_notify(avr_io_getirq(session->avr,
+			AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT), uart_output, session);
+	session->button = avr_io_getirq(session->avr, AVR_IOCTL_IOPORT_GETIRQ('B'), 0);
+
+	/* Push button 0 (after the firmware has set up its interrupts) to
+	 * get past the splash screen
+	 */
+	session->push_cycle = START_BUTTON_MS * CYCLES_PER_MS;
+	session->release_cycle = (START_BUTTON_MS + BUTTON_PUSH_MS) * CYCLES_PER_MS;
+
+	struct epoll_event event = {.events = EPOLLIN | EPOLLRDHUP, .data.ptr = session};
+	session->events = event.events;
+	if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+		avr_terminate(session->avr);
+		free(session);
+		return NULL;
+	}
+	session->index = num_sessions;
+	sessions[num_sessions++] = session;
+	sessions_opened++;
+	fprintf(stderr, "session %d opened\n", session->id);
+	return session;
+}
+
+static void close_handler(Handler* handler) {
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, handler->fd, NULL);
+	close(handler->fd);
+	handler->fd = -1;
+	handler->next_closed = closed_handlers;
+	closed_handlers = handler;
+}
+
+static void close_spectator(Spectator* spectator) {
+	if(spectator->session) {
+		if(spectator->previous) {
+			spectator->previous->next = spectator->next;
+		} else {
+			spectator->session->spectators = spectator->next;
+		}
+		if(spectator->next) {
+			spectator->next->previous = spectator->previous;
+		}
+	}
+	num_spectators--;
+	close_handler(&spectator->handler);
+}
+
+static void close_session(Session* session) {
+	while(session->spectators) {
+		close_spectator(session->spectators);
+	}
+	/* Move the last session into the gap */
+	sessions[session->index] = sessions[--num_sessions];
+	sessions[session->index]->index = session->index;
+	close_handler(&session->handler);
+}
+
+static void free_closed_handlers(void) {
+	while(closed_handlers) {
+		Handler* handler = closed_handlers;
+		closed_handlers = handler->next_closed;
+		if(handler->kind == HANDLER_SESSION) {
+			avr_terminate(((Session*)handler)->avr);
+		} else {
+			queue_clear(&((Spectator*)handler)->queue);
+		}
+		free(handler);
+	}
+}
+
+/* Send as much waiting output as the socket will take. Returns -1 if the
+ * client has gone.
+ */
+static int flush_output(Session* session) {
+	while(session->output_length) {
+		ssize_t sent = send(session->handler.fd,
+				session->output + session->output_start,
+				session->output_length, MSG_NOSIGNAL);
+		if(sent < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+		}
+		session->output_start += sent;
+		session->output_length -= sent;
+	}
+	session->output_start = 0;
+	return 0;
+}
+
+/* Read what the client has sent into the input buffer. Returns -1 if the
+ * client has gone.
+ */
+static int read_input(Session* session) {
+	while(session->input_length < INPUT_BUFFER_SIZE) {
+		int end = (session->input_start + session->input_length) % INPUT_BUFFER_SIZE;
+		int space = (end >= session->input_start) ? INPUT_BUFFER_SIZE - end :
+				session->input_start - end;
+		ssize_t received = recv(session->handler.fd, session->input + end, space, 0);
+		if(received == 0) {
+			return -1;
+		} else if(received < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+		}
+		session->input_length += received;
+	}
+	return 0;
+}
+
+/* Simulate the board up to its target cycle, feeding in input from the
+ * client. Returns -1 if the firmware has stopped.
+ */
+static int run_session(Session* session) {
+	avr_t* avr = session->avr;
+	uint64_t start = avr->cycle;
+
+	while(avr->cycle < session->target_cycle &&
+			session->output_length < OUTPUT_HIGH_WATER) {
+		if(session->input_length && avr->cycle >= session->next_char_cycle) {
+			avr_raise_irq(session->uart_input, session->input[session->input_start]);
+			session->input_start = (session->input_start + 1) % INPUT_BUFFER_SIZE;
+			session->input_length--;
+			session->next_char_cycle = avr->cycle + CYCLES_PER_CHAR;
+		}
+		if(session->push_cycle && avr->cycle >= session->push_cycle) {
+			avr_raise_irq(session->button, 1);
+			session->push_cycle = 0;
+		} else if(session->release_cycle && avr->cycle >= session->release_cycle) {
+			avr_raise_irq(session->button, 0);
+			session->release_cycle = 0;
+		}
+		int state = avr_run(avr);
+		if(state == cpu_Done || state == cpu_Crashed) {
+			return -1;
+		}
+	}
+	cycles_run += avr->cycle - start;
+	return 0;
+}
+
+/* Register interest in reading from the spectator until it stops sending
+ * (it may do so once it has picked a session) and in writing to it while
+ * output is waiting.
+ */
+static void update_spectator_events(Spectator* spectator) {
+	uint32_t events = spectator->reading ? EPOLLIN : 0;
+	if(spectator->queue.count) {
+		events |= EPOLLOUT;
+	}
+	if(events != spectator->events) {
+		struct epoll_event event = {.events = events, .data.ptr = spectator};
+		epoll_ctl(epoll_fd, EPOLL_CTL_MOD, spectator->handler.fd, &event);
+		spectator->events = events;
+	}
+}
+
+/* Read the number of the session to watch. Anything sent after that is
+ * ignored. Returns -1 if the spectator has gone without choosing or asked
+ * for a session that doesn't exist.
+ */
+static int read_spectator(Spectator* spectator) {
+	char buffer[64];
+	ssize_t received;
+
+	while((received = recv(spectator->handler.fd, buffer, sizeof(buffer), 0)) > 0) {
+		for(ssize_t i = 0; i < received && !spectator->session; i++) {
+			if(buffer[i] != '\n') {
+				if(spectator->line_length < (int)sizeof(spectator->line) - 1) {
+					spectator->line[spectator->line_length++] = buffer[i];
+				}
+				continue;
+			}
+			spectator->line[spectator->line_length] = 0;
+			int id = atoi(spectator->line);
+			for(int j = 0; j < num_sessions; j++) {
+				if(sessions[j]->id == id) {
+					spectator->session = sessions[j];
+				}
+			}
+			if(!spectator->session) {
+				static const char message[] = "No such session\r\n";
+				send(spectator->handler.fd, message, sizeof(message) - 1, MSG_NOSIGNAL);
+				return -1;
+			}
+			/* Start with the screen so far */
+			spectator->next = spectator->session->spectators;
+			if(spectator->next) {
+				spectator->next->previous = spectator;
+			}
+			spectator->session->spectators = spectator;
+			spectator->needs_keyframe = 1;
+		}
+	}
+	if(received == 0) {
+		/* Nothing more to read, but carry on watching if a session has
+		 * been chosen
+		 */
+		spectator->reading = 0;
+		return spectator->session ? 0 : -1;
+	}
+	return (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) ? -1 : 0;
+}
+
+/* Pass what the board sent this tick on to its spectators: one shared
+ * chunk for all of them, and one shared keyframe for any that need one.
+ */
+static void broadcast(Session* session, const uint8_t* data, size_t length) {
+	Chunk* chunk = NULL;
+	Chunk* keyframe = NULL;
+	Spectator* next;
+
+	mirror_feed(&session->mirror, data, length);
+	if(length && session->spectators) {
+		chunk = chunk_new(data, length);
+	}
+	for(Spectator* spectator = session->spectators; spectator; spectator = next) {
+		next = spectator->next;
+		if(chunk && !spectator->needs_keyframe &&
+				queue_push(&spectator->queue, chunk) != 0) {
+			/* Fallen too far behind - the queue has been thrown away */
+			spectator->needs_keyframe = 1;
+			resyncs++;
+		}
+		if(spectator->needs_keyframe && mirror_at_boundary(&session->mirror)) {
+			if(!keyframe) {
+				keyframe = mirror_keyframe(&session->mirror);
+			}
+			queue_push(&spectator->queue, keyframe);
+			spectator->needs_keyframe = 0;
+		}
+		if(queue_send(&spectator->queue, spectator->handler.fd) != 0) {
+			close_spectator(spectator);
+			continue;
+		}
+		update_spectator_events(spectator);
+	}
+	if(chunk) {
+		chunk_unref(chunk);
+	}
+	if(keyframe) {
+		chunk_unref(keyframe);
+	}
+}
+
+/* The timer has fired ticks times: move every board on */
+static void run_sessions(uint64_t ticks) {
+	for(int i = 0; i < num_sessions; i++) {
+		Session* session = sessions[i];
+		uint64_t cycle = session->avr->cycle;
+		if(session->output_length >= OUTPUT_HIGH_WATER) {
+			/* Paused until the client catches up */
+			session->target_cycle = cycle;
+			continue;
+		}
+		session->target_cycle += ticks * TICK_MS * CYCLES_PER_MS;
+		if(session->target_cycle > cycle + MAX_LAG_MS * CYCLES_PER_MS) {
+			cycles_skipped += session->target_cycle - cycle - MAX_LAG_MS * CYCLES_PER_MS;
+			session->target_cycle = cycle + MAX_LAG_MS * CYCLES_PER_MS;
+		}
+		int before = session->output_length;
+		if(run_session(session) != 0) {
+			close_session(session);
+			i--;		/* the last session has moved into this slot */
+			continue;
+		}
+		/* What was sent this tick is at the end of the output buffer */
+		broadcast(session, session->output + session->output_start + before,
+				session->output_length - before);
+		if(flush_output(session) != 0) {
+			close_session(session);
+			i--;		/* the last session has moved into this slot */
+			continue;
+		}
+		update_events(session);
+	}
+}
+
+static void accept_spectator(int fd) {
+	Spectator* spectator = calloc(1, sizeof(Spectator));
+	int size = SPECTATOR_SEND_BUFFER;
+	if(!spectator) {
+		close(fd);
+		return;
+	}
+	setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+	spectator->handler.kind = HANDLER_SPECTATOR;
+	spectator->handler.fd = fd;
+	spectator->reading = 1;
+	spectator->events = EPOLLIN;
+	struct epoll_event event = {.events = spectator->events, .data.ptr = spectator};
+	if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+		close(fd);
+		free(spectator);
+		return;
+	}
+	num_spectators++;
+}
+
+static void accept_clients(Handler* listener) {
+	int fd, one = 1;
+	while((fd = accept4(listener->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+		if(listener->kind == HANDLER_SPECTATOR_LISTENER) {
+			accept_spectator(fd);
+			continue;
+		}
+		if(num_sessions >= max_sessions) {
+			static const char message[] = "Server full\r\n";
+			send(fd, message, sizeof(message) - 1, MSG_NOSIGNAL);
+			close(fd);
+			continue;
+		}
+		/* (Fails harmlessly on Unix sockets) */
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		if(!open_session(fd)) {
+			close(fd);
+		}
+	}
+}
+
+static void print_stats(uint64_t elapsed_ms) {
+	double wanted = (double)(cycles_run + cycles_skipped);
+	fprintf(stderr, "%d sessions (%llu opened), %.1f%% of real time, "
+			"%.1f%% skipped, %d spectators, %llu resynced\n", num_sessions,
+			(unsigned long long)sessions_opened,
+			num_sessions ? 100.0 * cycles_run / (num_sessions *
+					(double)elapsed_ms * CYCLES_PER_MS) : 0.0,
+			wanted > 0 ? 100.0 * cycles_skipped / wanted : 0.0,
+			num_spectators, (unsigned long long)resyncs);
+	cycles_run = cycles_skipped = resyncs = 0;
+}
+
+static int listen_on(Handler* handler, HandlerKind kind, struct sockaddr* address,
+		socklen_t length) {
+	int one = 1;
+	handler->kind = kind;
+	handler->fd = socket(address->sa_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if(handler->fd < 0) {
+		return -1;
+	}
+	setsockopt(handler->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if(bind(handler->fd, address, length) != 0 || listen(handler->fd, SOMAXCONN) != 0) {
+		return -1;
+	}
+	struct epoll_event event = {.events = EPOLLIN, .data.ptr = handler};
+	return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, handler->fd, &event);
+}
+
+int main(int argc, char** argv) {
+	static Handler listeners[4], timer;
+	struct epoll_event events[MAX_EVENTS];
+	const char* unix_paths[2] = {NULL, NULL};
+	int ports[2] = {5555, 5556}, opt;
+	uint64_t stats_ms = 0;
+
+	while((opt = getopt(argc, argv, "m:p:u:n:s:w:")) != -1) {
+		if(opt == 'm') {
+			mcu = optarg;
+		} else if(opt == 'p') {
+			ports[0] = atoi(optarg);
+		} else if(opt == 'u') {
+			unix_paths[0] = optarg;
+		} else if(opt == 'n') {
+			max_sessions = atoi(optarg);
+		} else if(opt == 's') {
+			ports[1] = atoi(optarg);
+		} else if(opt == 'w') {
+			unix_paths[1] = optarg;
+		}
+	}
+	if(argc - optind != 1 || max_sessions < 1) {
+		fprintf(stderr, "usage: %s [-m mcu] [-p port] [-u socket path] "
+				"[-n max sessions] [-s spectator port] "
+				"[-w spectator socket path] <firmware.elf>\n", argv[0]);
+		return 2;
+	}
+	if(elf_read_firmware(argv[optind], &firmware) != 0) {
+		fprintf(stderr, "can't load %s\n", argv[optind]);
+		return 2;
+	}
+	sessions = calloc(max_sessions, sizeof(Session*));
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+	/* Players, then spectators */
+	for(int i = 0; i < 2; i++) {
+		HandlerKind kind = i ? HANDLER_SPECTATOR_LISTENER : HANDLER_LISTENER;
+		struct sockaddr_in tcp_address = {.sin_family = AF_INET};
+		struct sockaddr_un unix_address = {.sun_family = AF_UNIX};
+		tcp_address.sin_port = htons(ports[i]);
+		tcp_address.sin_addr.s_addr = htonl(INADDR_ANY);
+		if(listen_on(&listeners[2 * i], kind, (struct sockaddr*)&tcp_address,
+				sizeof(tcp_address)) != 0) {
+			perror("TCP socket");
+			return 1;
+		}
+		if(unix_paths[i]) {
+			snprintf(unix_address.sun_path, sizeof(unix_address.sun_path), "%s",
+					unix_paths[i]);
+			unlink(unix_paths[i]);
+			if(listen_on(&listeners[2 * i + 1], kind, (struct sockaddr*)&unix_address,
+					sizeof(unix_address)) != 0) {
+				perror(unix_paths[i]);
+				return 1;
+			}
+		}
+	}
+
+	/* The one timer that drives every board */
+	struct itimerspec period = {
+		.it_interval = {0, TICK_MS * 1000000L},
+		.it_value = {0, TICK_MS * 1000000L}
+	};
+	timer.kind = HANDLER_TIMER;
+	timer.fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	timerfd_settime(timer.fd, 0, &period, NULL);
+	struct epoll_event timer_event = {.events = EPOLLIN, .data.ptr = &timer};
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer.fd, &timer_event);
+
+	fprintf(stderr, "listening on port %d%s%s, spectators on port %d%s%s\n",
+			ports[0], unix_paths[0] ? " and " : "", unix_paths[0] ? unix_paths[0] : "",
+			ports[1], unix_paths[1] ? " and " : "", unix_paths[1] ? unix_paths[1] : "");
+	while(1) {
+		int n = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+		if(n < 0 && errno != EINTR) {
+			perror("epoll_wait");
+			return 1;
+		}
+		for(int i = 0; i < n; i++) {
+			Handler* handler = events[i].data.ptr;
+			if(handler->fd < 0) {
+				/* Closed while dealing with an earlier event */
+				continue;
+			} else if(handler->kind == HANDLER_LISTENER ||
+					handler->kind == HANDLER_SPECTATOR_LISTENER) {
+				accept_clients(handler);
+			} else if(handler->kind == HANDLER_TIMER) {
+				uint64_t ticks;
+				if(read(timer.fd, &ticks, sizeof(ticks)) != sizeof(ticks)) {
+					continue;
+				}
+				run_sessions(ticks);
+				stats_ms += ticks * TICK_MS;
+				if(stats_ms >= STATS_SECONDS * 1000) {
+					print_stats(stats_ms);
+					stats_ms = 0;
+				}
+			} else if(handler->kind == HANDLER_SPECTATOR) {
+				Spectator* spectator = (Spectator*)handler;
+				if(((events[i].events & EPOLLIN) && read_spectator(spectator) != 0) ||
+						((events[i].events & EPOLLOUT) &&
+						queue_send(&spectator->queue, handler->fd) != 0) ||
+						(events[i].events & (EPOLLERR | EPOLLHUP))) {
+					close_spectator(spectator);
+					continue;
+				}
+				update_spectator_events(spectator);
+			} else {
+				Session* session = (Session*)handler;
+				if(((events[i].events & EPOLLIN) && read_input(session) != 0) ||
+						((events[i].events & EPOLLOUT) && flush_output(session) != 0) ||
+						(events[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP))) {
+					close_session(session);
+					continue;
+				}
+				update_events(session);
+			}
+		}
+		free_closed_handlers();
+	}
+}
@@ -0,0 +1,185 @@
+#!/usr/bin/env python3
+"""Draw games from the snake firmware's binary telemetry.
+
+With telemetry switched on ('v', from the next game) the firmware stops
+drawing the board on the terminal and instead sends a small binary frame
+for each change (see telemetry.h for the format). This script decodes
+the frames, keeps its own copy of the board and draws it.
+
+    telemetry_view.py <serial capture or device>     draw as frames arrive
+    telemetry_view.py --final <serial capture>       print each final board
+
+A file name of - reads standard input, so a live serial port can be
+piped in (e.g. from a terminal program or cat /dev/ttyUSB0 once the baud
+rate has been set with stty). Anything between frames (text, replay and
+export strings) is skipped.
+"""
+
+import argparse
+import collections
+import sys
+
+SYNC = 0xA5
+KEYFRAME, STEP, ITEM, END = 0x01, 0x02, 0x03, 0x04
+FOOD, SUPER_FOOD, RAT = 0x00, 0x01, 0x02
+REMOVED = 0x80
+INVALID = 0x08
+
+
+def crc8(data):
+    """CRC-8 with polynomial 0x07 and initial value 0 (as _crc8_ccitt_update)."""
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = (crc << 1 ^ 0x07 if crc & 0x80 else crc << 1) & 0xFF
+    return crc
+
+
+class FrameReader:
+    """Pull frames out of a byte stream fed to it in pieces."""
+
+    def __init__(self):
+        self.buffer = bytearray()
+        self.bad = 0                # frames dropped with a bad CRC
+
+    def feed(self, data):
+        """Add data and yield (type, payload) for each complete frame."""
+        self.buffer += data
+        while True:
+            start = self.buffer.find(SYNC)
+            if start < 0:
+                self.buffer.clear()
+                return
+            del self.buffer[:start]
+            if len(self.buffer) < 3:
+                return
+            length = self.buffer[2]
+            if len(self.buffer) < length + 4:
+                return
+            body = bytes(self.buffer[1:length + 3])
+            if crc8(body) != self.buffer[length + 3]:
+                # Not a frame (or a damaged one) - look for the next sync
+                self.bad += 1
+                del self.buffer[0]
+                continue
+            del self.buffer[:length + 4]
+            yield body[0], body[2:]
+
+
+class Board:
+    """Game state rebuilt from frames."""
+
+    def __init__(self):
+        self.snake = collections.deque()    # positions, tail first
+        self.food = set()
+        self.rat = INVALID
+        self.super_food = INVALID
+        self.score = 0
+        self.over = False
+
+    def apply(self, kind, payload):
+        """Update the board from a frame. Returns False for unknown frames."""
+        if kind == KEYFRAME:
+            length = payload[0]
+            self.snake = collections.deque(payload[1:1 + length])
+            pos = 1 + length
+            num_food = payload[pos]
+            self.food = set(payload[pos + 1:pos + 1 + num_food])
+            pos += 1 + num_food
+            self.rat, self.super_food = payload[pos], payload[pos + 1]
+            self.score = int.from_bytes(payload[pos + 2:pos + 6], 'little')
+            self.over = False
+        elif kind == STEP:
+            head, freed_tail, points, length = payload
+            self.snake.append(head)
+            if freed_tail != INVALID and self.snake:
+                self.snake.popleft()
+            self.food.discard(head)
+            self.score += points
+            if len(self.snake) != length:
+                print('length mismatch: %d != %d' % (len(self.snake), length),
+                      file=sys.stderr)
+        elif kind == ITEM:
+            item, posn = payload
+            removed = item & REMOVED
+            item &= ~REMOVED
+            if item == FOOD:
+                (self.food.discard if removed else self.food.add)(posn)
+            elif item == SUPER_FOOD:
+                self.super_food = INVALID if removed else posn
+            elif item == RAT:
+                self.rat = INVALID if removed else posn
+        elif kind == END:
+            self.score = int.from_bytes(payload[0:4], 'little')
+            self.over = True
+        else:
+            return False
+        return True
+
+    def render(self, width, height):
+        """Return the board as lines of text, top row first."""
+        cells = {}
+        for posn in self.food:
+            cells[posn] = '*'
+        for posn, mark in ((self.rat, 'r'), (self.super_food, '$')):
+            if posn != INVALID:
+                cells[posn] = mark
+        for posn in self.snake:
+            cells[posn] = 'o'
+        if self.snake:
+            cells[self.snake[-1]] = 'X' if self.over else '@'
+        lines = ['+' + '-' * width + '+']
+        for y in reversed(range(height)):
+            lines.append('|' + ''.join(cells.get(x << 4 | y, ' ')
+                                       for x in range(width)) + '|')
+        lines.append(lines[0])
+        lines.append('score %d  length %d%s' % (
+            self.score, len(self.snake), '  GAME OVER' if self.over else ''))
+        return lines
+
+
+def chunks(source):
+    """Yield the data from a file (or standard input) as it arrives."""
+    while True:
+        data = source.read1(4096) if hasattr(source, 'read1') else \
+            source.read(4096)
+        if not data:
+            return
+        yield data
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('input', help='serial capture or device (- for stdin)')
+    parser.add_argument('--final', action='store_true',
+                        help='only print each board at game over')
+    parser.add_argument('--width', type=int, default=16)
+    parser.add_argument('--height', type=int, default=8)
+    args = parser.parse_args()
+
+    source = sys.stdin.buffer if args.input == '-' else open(args.input, 'rb')
+    reader = FrameReader()
+    board = Board()
+    games = 0
+    for data in chunks(source):
+        for kind, payload in reader.feed(data):
+            if not board.apply(kind, payload):
+                continue
+            if kind == END:
+                games += 1
+            if args.final:
+                if kind == END:
+                    print('--- game %d' % games)
+                    print('\n'.join(board.render(args.width, args.height)))
+            else:
+                # Redraw in place
+                sys.stdout.write('\x1b[H\x1b[2J' + '\n'.join(
+                    board.render(args.width, args.height)) + '\n')
+                sys.stdout.flush()
+    if reader.bad:
+        print('%d damaged frames skipped' % reader.bad, file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+"""Print the event traces dumped by the snake firmware as a timeline.
+
+Build the firmware with TRACE_ENABLED defined. The trace is then dumped
+inside an ANSI application program command string (ESC _ T <hex> ESC \\)
+at game over and when 'd' is pressed. Capture the serial output to a
+file and pass it to this script; each dump in the capture is printed in
+turn. See trace.h for the format and the event codes.
+"""
+
+import re
+import sys
+
+CHUNK = re.compile(rb'\x1b_T([0-9A-F]*)\x1b\\')
+
+DIRECTIONS = 'up', 'right', 'down', 'left'
+CONTROLLERS = 'human', 'autopilot', 'hamiltonian', 'mcts', 'neural'
+MOVE_RESULTS = {
+    -1: 'out of bounds', -2: 'collision', -3: 'snake length error',
+    1: 'moved', 2: 'ate food', 3: 'ate food but can\'t grow',
+    4: 'ate super food', 5: 'ate rat',
+}
+
+
+def cell(posn):
+    if posn & 0x08:
+        return 'none'
+    return '(%d,%d)' % (posn >> 4, posn & 0x07)
+
+
+def character(arg):
+    return repr(chr(arg))
+
+
+def name(names, arg):
+    return names[arg] if arg < len(names) else str(arg)
+
+
+def signed(arg):
+    return arg - 256 if arg >= 128 else arg
+
+
+# Event code -> (name, function to describe the argument)
+EVENTS = {
+    0x01: ('game start', lambda a: 'controller ' + name(CONTROLLERS, a)),
+    0x02: ('game over', lambda a: 'length %d' % a),
+    0x03: ('button', lambda a: 'button %d' % a),
+    0x04: ('serial rx', character),
+    0x05: ('serial lost', character),
+    0x06: ('direction', lambda a: name(DIRECTIONS, a)),
+    0x07: ('snake move', lambda a: MOVE_RESULTS.get(signed(a), str(a))),
+    0x08: ('collision', cell),
+    0x09: ('food added', cell),
+    0x0A: ('food eaten', cell),
+    0x0B: ('rat move', cell),
+    0x0C: ('rat stuck', cell),
+    0x0D: ('super food', cell),
+}
+
+
+def timeline(data):
+    """Yield (tick, event name, description) for each entry in a dump.
+
+    Ticks are 16 bits so they wrap every 65.536s; they are unwrapped
+    here on the assumption that entries are less than that apart.
+    """
+    last = None
+    base = 0
+    for pos in range(0, len(data) - 3, 4):
+        tick = data[pos] | data[pos + 1] << 8
+        event, arg = data[pos + 2], data[pos + 3]
+        if event == 0:
+            continue            # unused entry
+        if last is not None and tick < last:
+            base += 0x10000
+        last = tick
+        event_name, describe = EVENTS.get(
+            event, ('event 0x%02X' % event, str))
+        yield base + tick, event_name, describe(arg)
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit('usage: %s <serial capture>' % sys.argv[0])
+    with open(sys.argv[1], 'rb') as capture:
+        dumps = CHUNK.findall(capture.read())
+    for number, chunk in enumerate(dumps, 1):
+        print('--- trace %d' % number)
+        entries = list(timeline(bytes.fromhex(chunk.decode())))
+        start = entries[0][0] if entries else 0
+        for tick, event_name, description in entries:
+            print('%+9d ms  %-12s %s' % (tick - start, event_name, description))
+
+
+if __name__ == '__main__':
+    main()